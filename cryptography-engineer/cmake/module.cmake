@@ -5,6 +5,7 @@
 # Scans for all .cpp files in a subdirectory, and creates a library named <module_name>.
 # Scans for all .test.cpp files in a subdirectory, and creates a gtest binary named <module name>_tests.
 # Scans for all .bench.cpp files in a subdirectory, and creates a benchmark binary named <module name>_bench.
+# Its run_<module name>_bench target also writes the results to <module name>_bench.json in the build directory.
 #
 # We have to get a bit complicated here, due to the fact CMake will not parallelise the building of object files
 # between dependent targets, due to the potential of post-build code generation steps etc.
@@ -172,7 +173,7 @@ function(barretenberg_module MODULE_NAME)
 
         add_custom_target(
             run_${MODULE_NAME}_bench
-            COMMAND ${MODULE_NAME}_bench
+            COMMAND ${MODULE_NAME}_bench --benchmark_out=${MODULE_NAME}_bench.json --benchmark_out_format=json
             WORKING_DIRECTORY ${CMAKE_BINARY_DIR}
         )
     endif()
@@ -0,0 +1,176 @@
+#pragma once
+#include <numeric/bitop/get_msb.hpp>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace waffle {
+namespace g1_fft {
+
+inline uint32_t reverse_bits(uint32_t x, uint32_t bit_length)
+{
+    x = (((x & 0xaaaaaaaa) >> 1) | ((x & 0x55555555) << 1));
+    x = (((x & 0xcccccccc) >> 2) | ((x & 0x33333333) << 2));
+    x = (((x & 0xf0f0f0f0) >> 4) | ((x & 0x0f0f0f0f) << 4));
+    x = (((x & 0xff00ff00) >> 8) | ((x & 0x00ff00ff) << 8));
+    return (((x >> 16) | (x << 16))) >> (32 - bit_length);
+}
+
+namespace bit_reverse_detail {
+
+// Tiles of 16 × 16 points: a tile buffer is 24 KiB of g1::element, and a run 1.5 KiB.
+constexpr size_t LOG_TILE_SIZE = 4;
+constexpr size_t TILE_SIZE = 1UL << LOG_TILE_SIZE;
+
+struct tile_layout {
+    size_t log_middle;
+    // Distance between the runs of a tile.
+    size_t stride;
+
+    explicit tile_layout(size_t n)
+        : log_middle(numeric::get_msb(n) - 2 * LOG_TILE_SIZE)
+        , stride(n >> LOG_TILE_SIZE)
+    {}
+
+    size_t num_tiles() const { return 1UL << log_middle; }
+
+    size_t reverse_middle(size_t c) const
+    {
+        return log_middle == 0 ? 0 : reverse_bits(static_cast<uint32_t>(c), static_cast<uint32_t>(log_middle));
+    }
+
+    size_t run(size_t a, size_t c) const { return a * stride + (c << LOG_TILE_SIZE); }
+};
+
+inline const std::array<uint8_t, TILE_SIZE>& reversed_tile_indices()
+{
+    static const std::array<uint8_t, TILE_SIZE> table = [] {
+        std::array<uint8_t, TILE_SIZE> result;
+        for (size_t i = 0; i < TILE_SIZE; ++i) {
+            result[i] = static_cast<uint8_t>(reverse_bits(static_cast<uint32_t>(i), LOG_TILE_SIZE));
+        }
+        return result;
+    }();
+    return table;
+}
+
+template <typename Point> void load_tile(const Point* points, const tile_layout& layout, size_t c, Point* buffer)
+{
+    for (size_t a = 0; a < TILE_SIZE; ++a) {
+        const Point* run = points + layout.run(a, c);
+        for (size_t b = 0; b < TILE_SIZE; ++b) {
+            buffer[(a << LOG_TILE_SIZE) | b] = run[b];
+        }
+    }
+}
+
+// Writes the tile of `c`, held in `buffer`, to its place in the tile of rev(c).
+template <typename Point> void store_tile(const Point* buffer, const tile_layout& layout, size_t c, Point* points)
+{
+    const auto& rev = reversed_tile_indices();
+    const size_t reversed_c = layout.reverse_middle(c);
+    for (size_t b = 0; b < TILE_SIZE; ++b) {
+        Point* run = points + layout.run(rev[b], reversed_c);
+        for (size_t reversed_a = 0; reversed_a < TILE_SIZE; ++reversed_a) {
+            run[reversed_a] = buffer[(static_cast<size_t>(rev[reversed_a]) << LOG_TILE_SIZE) | b];
+        }
+    }
+}
+
+} // namespace bit_reverse_detail
+
+/**
+ * Permutes `points` into bit-reversed order, in place. n must be a power of two.
+ *
+ * The permutation is blocked in the manner of COBRA (Carter and Gatlin). Split the index of a point into its top t bits
+ * a, middle bits c and low t bits b. The permutation sends (a, c, b) to (rev(b), rev(c), rev(a)), so the 2^t × 2^t
+ * tile of points sharing c, which is 2^t runs of 2^t contiguous points, maps onto the tile sharing rev(c), transposed.
+ * Each tile is read run by run into a buffer and written out run by run, instead of one point at a time to pages all
+ * over the array; and tiles are independent, so threads take them in parallel. Arrays of fewer than 2^(2t) points fit
+ * in cache, and are permuted directly.
+ */
+template <typename Point> void bit_reverse(Point* points, const size_t n)
+{
+    using namespace bit_reverse_detail;
+    if (n <= 2) {
+        return;
+    }
+    const auto log2_n = static_cast<uint32_t>(numeric::get_msb(n));
+    if (log2_n < 2 * LOG_TILE_SIZE) {
+        for (size_t i = 0; i < n; ++i) {
+            const size_t swap_index = reverse_bits(static_cast<uint32_t>(i), log2_n);
+            if (i < swap_index) {
+                std::swap(points[i], points[swap_index]);
+            }
+        }
+        return;
+    }
+
+    // The tiles of c and rev(c) trade places, so each pair is handled once, by whoever takes the smaller of the two.
+    const tile_layout layout(n);
+    const size_t num_tiles = layout.num_tiles();
+#ifndef NO_MULTITHREADING
+#pragma omp parallel
+#endif
+    {
+        std::vector<Point> own(TILE_SIZE * TILE_SIZE);
+        std::vector<Point> partner(TILE_SIZE * TILE_SIZE);
+#ifndef NO_MULTITHREADING
+#pragma omp for schedule(dynamic, 16)
+#endif
+        for (size_t c = 0; c < num_tiles; ++c) {
+            const size_t reversed_c = layout.reverse_middle(c);
+            if (reversed_c < c) {
+                continue;
+            }
+            load_tile(points, layout, c, &own[0]);
+            if (reversed_c != c) {
+                load_tile(points, layout, reversed_c, &partner[0]);
+                store_tile(&partner[0], layout, reversed_c, points);
+            }
+            store_tile(&own[0], layout, c, points);
+        }
+    }
+}
+
+/**
+ * Writes `source` to `destination` in bit-reversed order, which fuses the permutation into a copy that a caller makes
+ * anyway: an FFT of natural-order input needs no other permutation. The arrays must not overlap.
+ */
+template <typename Point> void bit_reverse_copy(const Point* source, Point* destination, const size_t n)
+{
+    using namespace bit_reverse_detail;
+    if (n <= 2) {
+        std::copy(source, source + n, destination);
+        return;
+    }
+    const auto log2_n = static_cast<uint32_t>(numeric::get_msb(n));
+    if (log2_n < 2 * LOG_TILE_SIZE) {
+        for (size_t i = 0; i < n; ++i) {
+            destination[reverse_bits(static_cast<uint32_t>(i), log2_n)] = source[i];
+        }
+        return;
+    }
+
+    const tile_layout layout(n);
+    const size_t num_tiles = layout.num_tiles();
+#ifndef NO_MULTITHREADING
+#pragma omp parallel
+#endif
+    {
+        std::vector<Point> buffer(TILE_SIZE * TILE_SIZE);
+#ifndef NO_MULTITHREADING
+#pragma omp for schedule(dynamic, 16)
+#endif
+        for (size_t c = 0; c < num_tiles; ++c) {
+            load_tile(source, layout, c, &buffer[0]);
+            store_tile(&buffer[0], layout, c, destination);
+        }
+    }
+}
+
+} // namespace g1_fft
+} // namespace waffle
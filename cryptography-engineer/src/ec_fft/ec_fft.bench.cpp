@@ -0,0 +1,103 @@
+#include "ec_fft.hpp"
+#include <benchmark/benchmark.h>
+
+using namespace benchmark;
+using namespace barretenberg;
+
+namespace {
+
+constexpr size_t MIN_LOG_N = 10;
+constexpr size_t MAX_LOG_N = 20;
+
+/**
+ * 2^MAX_LOG_N points, generated once. Consecutive multiples of a random point take one addition each, where random
+ * multiples of the generator would take a scalar multiplication each.
+ */
+const std::vector<g1::affine_element>& points()
+{
+    static const std::vector<g1::affine_element> affine = [] {
+        const size_t n = 1UL << MAX_LOG_N;
+        std::vector<g1::element> elements(n);
+        const g1::element step = g1::one * fr::random_element();
+        elements[0] = step;
+        for (size_t i = 1; i < n; ++i) {
+            elements[i] = elements[i - 1] + step;
+        }
+        // Normalised once for all, so that reading off the affine coordinates costs no inversions.
+        g1::element::batch_normalize(&elements[0], n);
+        std::vector<g1::affine_element> result(n);
+        for (size_t i = 0; i < n; ++i) {
+            result[i] = g1::affine_element(elements[i].x, elements[i].y);
+        }
+        return result;
+    }();
+    return affine;
+}
+
+void ec_fft(State& state) noexcept
+{
+    const auto n = static_cast<size_t>(state.range(0));
+    evaluation_domain domain(n);
+    domain.compute_lookup_table();
+    std::vector<g1::element> elements(n);
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::copy(points().begin(), points().begin() + static_cast<std::ptrdiff_t>(n), elements.begin());
+        state.ResumeTiming();
+        waffle::g1_fft::ec_fft(&elements[0], domain);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(ec_fft)->RangeMultiplier(4)->Range(1 << MIN_LOG_N, 1 << MAX_LOG_N)->Unit(kMillisecond);
+
+void ec_ifft(State& state) noexcept
+{
+    const auto n = static_cast<size_t>(state.range(0));
+    evaluation_domain domain(n);
+    domain.compute_lookup_table();
+    std::vector<g1::element> elements(n);
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::copy(points().begin(), points().begin() + static_cast<std::ptrdiff_t>(n), elements.begin());
+        state.ResumeTiming();
+        waffle::g1_fft::ec_ifft(&elements[0], domain);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(ec_ifft)->RangeMultiplier(4)->Range(1 << MIN_LOG_N, 1 << MAX_LOG_N)->Unit(kMillisecond);
+
+void ec_fft_affine(State& state) noexcept
+{
+    const auto n = static_cast<size_t>(state.range(0));
+    evaluation_domain domain(n);
+    domain.compute_lookup_table();
+    std::vector<g1::affine_element> points_copy(n);
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::copy(points().begin(), points().begin() + static_cast<std::ptrdiff_t>(n), points_copy.begin());
+        state.ResumeTiming();
+        waffle::g1_fft::ec_fft_affine(&points_copy[0], domain);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(ec_fft_affine)->RangeMultiplier(4)->Range(1 << MIN_LOG_N, 1 << MAX_LOG_N)->Unit(kMillisecond);
+
+void convert_srs(State& state) noexcept
+{
+    const auto n = static_cast<size_t>(state.range(0));
+    evaluation_domain domain(n);
+    domain.compute_lookup_table();
+    std::vector<g1::affine_element> monomial_srs(points().begin(), points().begin() + static_cast<std::ptrdiff_t>(n));
+    // Room for a pippenger point table, as callers allocate it.
+    std::vector<g1::affine_element> lagrange_srs(2 * n);
+    for (auto _ : state) {
+        waffle::g1_fft::convert_srs(&monomial_srs[0], &lagrange_srs[0], domain);
+        DoNotOptimize(lagrange_srs[0]);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+BENCHMARK(convert_srs)->RangeMultiplier(4)->Range(1 << MIN_LOG_N, 1 << MAX_LOG_N)->Unit(kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -1,59 +1,475 @@
 #include "ec_fft.hpp"
-
-#pragma GCC diagnostic ignored "-Wunused-variable"
-#pragma GCC diagnostic ignored "-Wunused-parameter"
+#include "fft_kernels.hpp"
+#include <algorithm>
 
 namespace waffle {
 namespace g1_fft {
 
 using namespace barretenberg;
 
-inline bool is_power_of_two(uint64_t x)
+namespace {
+
+// Sub-FFTs of up to 2^MAX_LOG_BLOCK_SIZE points (96 KiB of g1::element) run start to finish on one thread.
+constexpr size_t MAX_LOG_BLOCK_SIZE = 10;
+
+// From 2^FOUR_STEP_MIN_LOG_SIZE points (1.5 MiB) on, the points outgrow L2 and the four-step engine takes over.
+constexpr size_t FOUR_STEP_MIN_LOG_SIZE = 14;
+
+// The four-step engine moves this many columns (or rows) at a time, so that its strided accesses still read and write
+// a few hundred contiguous bytes.
+constexpr size_t FOUR_STEP_GROUP_SIZE = 4;
+
+// Butterflies per batch inversion in the affine engine. An inversion costs a few hundred multiplications, which this
+// spreads to well under one per butterfly.
+constexpr size_t AFFINE_CHUNK_SIZE = 1024;
+
+/**
+ * Bit-reversal, then log2(n) rounds of butterflies over the whole array.
+ *
+ * After the permutation, the first rounds are a set of independent FFTs over contiguous blocks, so they are run block
+ * by block, one block per thread at a time and with no synchronisation between rounds. Blocks are at most
+ * 2^MAX_LOG_BLOCK_SIZE points, and small enough that there are at least as many blocks as threads. The remaining rounds
+ * each span blocks, and their n/2 independent butterflies are split evenly between the threads, with one barrier per
+ * round.
+ *
+ * If `scaling` is set, the transform is an inverse one, whose result it scales by 1/n at no extra pass: the last round
+ * computes x/n ± (ω⁻ʲ/n)y, which costs n/2 scalar multiplications more than x ± ω⁻ʲy, where scaling after the fact
+ * costs n. Blocks then stop short of the last round.
+ */
+template <typename Twiddles>
+void fft_direct(g1::element* g1_elements, const size_t n, const Twiddles& twiddles, const twiddle_cache* scaling)
+{
+    if (n == 1) {
+        if (scaling != nullptr) {
+            g1_elements[0] = scaling->scale(g1_elements[0]);
+        }
+        return;
+    }
+    const auto log2_n = static_cast<size_t>(numeric::get_msb(n));
+    bit_reverse(g1_elements, n);
+
+    const size_t num_threads = get_num_threads();
+    const size_t log2_threads = num_threads > 1 ? numeric::get_msb(num_threads - 1) + 1 : 0;
+    const size_t log2_block_size = std::min({ MAX_LOG_BLOCK_SIZE,
+                                              std::max<size_t>(1, log2_n - std::min(log2_n, log2_threads)),
+                                              (scaling != nullptr) ? log2_n - 1 : log2_n });
+    const size_t block_size = 1UL << log2_block_size;
+    const size_t num_blocks = n >> log2_block_size;
+
+#ifndef NO_MULTITHREADING
+#pragma omp parallel
+#endif
+    {
+#ifndef NO_MULTITHREADING
+#pragma omp for schedule(dynamic)
+#endif
+        for (size_t b = 0; b < num_blocks; ++b) {
+            fft_rounds(g1_elements + b * block_size, block_size, twiddles);
+        }
+
+        for (size_t m = block_size; m < n; m <<= 1) {
+            if (scaling != nullptr && 2 * m == n) {
+#ifndef NO_MULTITHREADING
+#pragma omp for
+#endif
+                for (size_t i = 0; i < m; ++i) {
+                    const g1::element x = scaling->scale(g1_elements[i]);
+                    const g1::element t = scaling->mul_inverse_scaled(g1_elements[i + m], i);
+                    g1_elements[i] = x + t;
+                    g1_elements[i + m] = x - t;
+                }
+                break;
+            }
+#ifndef NO_MULTITHREADING
+#pragma omp for
+#endif
+            for (size_t i = 0; i < (n >> 1); ++i) {
+                butterfly(g1_elements, twiddles, m, i);
+            }
+        }
+    }
+}
+
+/**
+ * The four-step (Bailey) FFT. With n = n₁n₂, input index j = j₁ + n₁j₂ and output index k = k₂ + n₂k₁,
+ *
+ *   X[k₂ + n₂k₁] = Σ_{j₁} (ω^{n₂})^{j₁k₁} · ω^{j₁k₂} · Σ_{j₂} (ω^{n₁})^{j₂k₂} x[j₁ + n₁j₂],
+ *
+ * so the transform is
+ *   1. an FFT of size n₂ down each of the n₁ columns x[j₁ + n₁·],
+ *   2. a multiplication of entry (j₁, k₂) by the twiddle ω^{j₁k₂},
+ *   3. an FFT of size n₁ along each of the n₂ rows, indexed by k₂.
+ * Steps 1 and 2 gather each column into a buffer and write it out transposed into a scratch array, so that step 3
+ * reads rows contiguously. n₁ and n₂ are about √n, so every sub-FFT runs in cache on one thread, and the points are
+ * streamed through memory twice instead of log2(n) times, at the price of about n extra twiddle multiplications.
+ * Columns (and rows) are moved FOUR_STEP_GROUP_SIZE at a time, so that the strided accesses still touch runs of
+ * contiguous points. The sub-FFTs use the radix-4 rounds, with the same twiddles: ω^{n₁} and ω^{n₂} are roots of
+ * unity of order n₂ and n₁.
+ *
+ * If `scaling` is set, the transform is an inverse one, and step 2 multiplies by ω⁻ᵗ/n in place of ω⁻ᵗ, which scales
+ * the result by 1/n for the cost of the n₁ + n₂ - 1 entries whose twiddle would have been 1.
+ */
+template <typename Twiddles>
+void fft_four_step(g1::element* g1_elements, const size_t n, const Twiddles& twiddles, const twiddle_cache* scaling)
+{
+    const auto log2_n = static_cast<size_t>(numeric::get_msb(n));
+    const size_t n1 = 1UL << (log2_n / 2);
+    const size_t n2 = n / n1;
+    const size_t group = std::min(FOUR_STEP_GROUP_SIZE, n1);
+    std::vector<g1::element> scratch(n);
+
+#ifndef NO_MULTITHREADING
+#pragma omp parallel
+#endif
+    {
+        std::vector<g1::element> buffer(group * std::max(n1, n2));
+
+#ifndef NO_MULTITHREADING
+#pragma omp for schedule(dynamic)
+#endif
+        for (size_t first = 0; first < n1; first += group) {
+            for (size_t j2 = 0; j2 < n2; ++j2) {
+                for (size_t c = 0; c < group; ++c) {
+                    buffer[c * n2 + j2] = g1_elements[first + c + n1 * j2];
+                }
+            }
+            for (size_t c = 0; c < group; ++c) {
+                g1::element* column = &buffer[c * n2];
+                bit_reverse_block(column, n2);
+                fft_rounds(column, n2, twiddles);
+            }
+            for (size_t k2 = 0; k2 < n2; ++k2) {
+                for (size_t c = 0; c < group; ++c) {
+                    const size_t t = (first + c) * k2;
+                    const g1::element& y = buffer[c * n2 + k2];
+                    if (scaling != nullptr) {
+                        scratch[k2 * n1 + first + c] = scaling->mul_inverse_scaled(y, t);
+                    } else {
+                        scratch[k2 * n1 + first + c] = (t == 0) ? y : twiddles(y, n / 2, t);
+                    }
+                }
+            }
+        }
+
+#ifndef NO_MULTITHREADING
+#pragma omp for schedule(dynamic)
+#endif
+        for (size_t first = 0; first < n2; first += group) {
+            for (size_t r = 0; r < group; ++r) {
+                g1::element* row = &scratch[(first + r) * n1];
+                bit_reverse_block(row, n1);
+                fft_rounds(row, n1, twiddles);
+            }
+            for (size_t k1 = 0; k1 < n1; ++k1) {
+                for (size_t r = 0; r < group; ++r) {
+                    g1_elements[first + r + n2 * k1] = scratch[(first + r) * n1 + k1];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * The terms of P + Q in Jacobian coordinates, U₁ = X₁Z₂², U₂ = X₂Z₁², S₁ = Y₁Z₂³, S₂ = Y₂Z₁³ and H = U₂ - U₁, kept by
+ * `add_sub_to_affine` between its two passes along with d = Z₁Z₂H, whose inverse it is after.
+ */
+struct add_sub_state {
+    fq u1;
+    fq u2;
+    fq s1;
+    fq s2;
+    fq h;
+    fq d;
+    // The product of the d of the pairs before this one.
+    fq prefix;
+    bool degenerate;
+};
+
+/**
+ * Sets `sums[i]` to P + Q and `differences[i]` to P - Q, in affine form, for the Jacobian points P = `p[i]` and
+ * Q = `q[i]`. In affine coordinates, both have slopes with the same denominator,
+ *
+ *   λ = (y₂ - y₁) / (x₂ - x₁) = (S₂ - S₁) / d,   λ' = (-y₂ - y₁) / (x₂ - x₁) = -(S₂ + S₁) / d,
+ *
+ * and 1/d also gives 1/(Z₁Z₂) = H/d, hence x₁, x₂ and y₁. So the whole batch takes a single inversion, shared in the
+ * way of barretenberg's `add_affine_points`, and about 25 multiplications per pair, where two Jacobian additions and
+ * their normalisation take about 40. Pairs involving the point at infinity, or with P = ±Q, have no such slope and
+ * are added in Jacobian form instead.
+ */
+void add_sub_to_affine(const g1::element* p,
+                       const g1::element* q,
+                       g1::affine_element* sums,
+                       g1::affine_element* differences,
+                       const size_t count,
+                       add_sub_state* state)
+{
+    fq accumulator = fq::one();
+    for (size_t i = 0; i < count; ++i) {
+        auto& t = state[i];
+        t.prefix = accumulator;
+        t.degenerate = p[i].is_point_at_infinity() || q[i].is_point_at_infinity();
+        if (t.degenerate) {
+            continue;
+        }
+        const fq z1z1 = p[i].z.sqr();
+        const fq z2z2 = q[i].z.sqr();
+        t.u1 = p[i].x * z2z2;
+        t.u2 = q[i].x * z1z1;
+        t.s1 = p[i].y * z2z2 * q[i].z;
+        t.s2 = q[i].y * z1z1 * p[i].z;
+        t.h = t.u2 - t.u1;
+        t.degenerate = t.h.is_zero();
+        if (!t.degenerate) {
+            t.d = p[i].z * q[i].z * t.h;
+            accumulator *= t.d;
+        }
+    }
+
+    accumulator = accumulator.invert();
+    for (size_t i = count - 1; i < count; --i) {
+        const auto& t = state[i];
+        if (t.degenerate) {
+            sums[i] = g1::affine_element(p[i] + q[i]);
+            differences[i] = g1::affine_element(p[i] - q[i]);
+            continue;
+        }
+        const fq d_inverse = accumulator * t.prefix;
+        accumulator *= t.d;
+        const fq z_inverse = d_inverse * t.h;
+        const fq z_inverse_squared = z_inverse.sqr();
+        const fq x1 = t.u1 * z_inverse_squared;
+        const fq x2 = t.u2 * z_inverse_squared;
+        const fq y1 = t.s1 * z_inverse_squared * z_inverse;
+        const fq lambda = (t.s2 - t.s1) * d_inverse;
+        const fq lambda_negated = -(t.s2 + t.s1) * d_inverse;
+        sums[i].x = lambda.sqr() - x1 - x2;
+        sums[i].y = lambda * (x1 - sums[i].x) - y1;
+        differences[i].x = lambda_negated.sqr() - x1 - x2;
+        differences[i].y = lambda_negated * (x1 - differences[i].x) - y1;
+    }
+}
+
+// One transform of `fft_affine_from_bit_reversed`.
+template <typename Twiddles> struct affine_transform {
+    g1::affine_element* points;
+    size_t n;
+    Twiddles twiddles;
+    const twiddle_cache* scaling;
+};
+
+/**
+ * Radix-2 FFTs over affine points, from bit-reversed order to natural order. Points are only Jacobian between a
+ * twiddle multiplication and the `add_sub_to_affine` of their butterfly. If `scaling` is set, the last round of a
+ * transform scales by 1/n as in `fft_direct`; `scaling` may be the cache of a larger domain, whose size n divides.
+ *
+ * The transforms run in lockstep, round by round, and the butterflies of a round, over all the transforms that have
+ * it, are split into chunks of AFFINE_CHUNK_SIZE, one batch inversion each, spread over the threads. So small
+ * transforms, which have too few butterflies per round to keep the threads busy on their own, fill in around large
+ * ones, and a batch of transforms takes as many barriers as its largest alone.
+ */
+template <typename Twiddles>
+void fft_affine_from_bit_reversed(const std::vector<affine_transform<Twiddles>>& transforms)
 {
-    return x && !(x & (x - 1));
+    // A transform of one point is the identity, its scaling by 1/1 included.
+    size_t max_butterflies = 0;
+    for (const auto& transform : transforms) {
+        ASSERT(transform.scaling == nullptr || transform.scaling->size() % transform.n == 0);
+        max_butterflies = std::max(max_butterflies, transform.n >> 1);
+    }
+    if (max_butterflies == 0) {
+        return;
+    }
+
+    // The chunks of a round are numbered through the transforms in turn; every transform keeps the same chunks from
+    // round to round, until it runs out of rounds.
+    std::vector<size_t> first_chunk(transforms.size() + 1, 0);
+    for (size_t t = 0; t < transforms.size(); ++t) {
+        const size_t num_butterflies = transforms[t].n >> 1;
+        first_chunk[t + 1] = first_chunk[t] + (num_butterflies + AFFINE_CHUNK_SIZE - 1) / AFFINE_CHUNK_SIZE;
+    }
+
+#ifndef NO_MULTITHREADING
+#pragma omp parallel
+#endif
+    {
+        const size_t chunk_size = std::min(AFFINE_CHUNK_SIZE, max_butterflies);
+        std::vector<g1::element> p(chunk_size);
+        std::vector<g1::element> q(chunk_size);
+        std::vector<g1::affine_element> sums(chunk_size);
+        std::vector<g1::affine_element> differences(chunk_size);
+        std::vector<add_sub_state> state(chunk_size);
+
+        for (size_t m = 1; m < 2 * max_butterflies; m <<= 1) {
+#ifndef NO_MULTITHREADING
+#pragma omp for schedule(dynamic)
+#endif
+            for (size_t c = 0; c < first_chunk.back(); ++c) {
+                const size_t t = static_cast<size_t>(
+                    std::upper_bound(first_chunk.begin(), first_chunk.end(), c) - first_chunk.begin() - 1);
+                const auto& transform = transforms[t];
+                if (m >= transform.n) {
+                    continue;
+                }
+                g1::affine_element* points = transform.points;
+                const size_t first = (c - first_chunk[t]) * AFFINE_CHUNK_SIZE;
+                const size_t count = std::min(AFFINE_CHUNK_SIZE, (transform.n >> 1) - first);
+                for (size_t s = 0; s < count; ++s) {
+                    const size_t i = first + s;
+                    const size_t j = i & (m - 1);
+                    const size_t k = ((i & ~(m - 1)) << 1) + j;
+                    p[s] = g1::element(points[k]);
+                    q[s] = g1::element(points[k + m]);
+                    if (transform.scaling != nullptr && 2 * m == transform.n) {
+                        // From the cache of a domain of size N = 2^d·n: x/n = 2^d·(x/N) and
+                        // ω_n^{-j}/n = 2^d·ω_N^{-2^d·j}/N.
+                        const size_t stride = transform.scaling->size() / transform.n;
+                        p[s] = transform.scaling->scale(p[s]);
+                        q[s] = transform.scaling->mul_inverse_scaled(q[s], j * stride);
+                        for (size_t d = stride; d > 1; d >>= 1) {
+                            p[s].self_dbl();
+                            q[s].self_dbl();
+                        }
+                    } else if (j != 0) {
+                        q[s] = transform.twiddles(q[s], m, j);
+                    }
+                }
+                add_sub_to_affine(&p[0], &q[0], &sums[0], &differences[0], count, &state[0]);
+                for (size_t s = 0; s < count; ++s) {
+                    const size_t i = first + s;
+                    const size_t j = i & (m - 1);
+                    const size_t k = ((i & ~(m - 1)) << 1) + j;
+                    points[k] = sums[s];
+                    points[k + m] = differences[s];
+                }
+            }
+        }
+    }
 }
 
-inline uint32_t reverse_bits(uint32_t x, uint32_t bit_length)
+// Small transforms fit in cache whole, and run directly; larger ones in four steps.
+template <typename Twiddles>
+void fft(g1::element* g1_elements, const size_t n, const Twiddles& twiddles, const twiddle_cache* scaling)
 {
-    x = (((x & 0xaaaaaaaa) >> 1) | ((x & 0x55555555) << 1));
-    x = (((x & 0xcccccccc) >> 2) | ((x & 0x33333333) << 2));
-    x = (((x & 0xf0f0f0f0) >> 4) | ((x & 0x0f0f0f0f) << 4));
-    x = (((x & 0xff00ff00) >> 8) | ((x & 0x00ff00ff) << 8));
-    return (((x >> 16) | (x << 16))) >> (32 - bit_length);
+    ASSERT(is_power_of_two(n));
+    if (n < (1UL << FOUR_STEP_MIN_LOG_SIZE)) {
+        fft_direct(g1_elements, n, twiddles, scaling);
+    } else {
+        fft_four_step(g1_elements, n, twiddles, scaling);
+    }
 }
 
-inline void ec_fft_inner(g1::element* g1_elements, const size_t n, const std::vector<fr*>& root_table)
+} // namespace
+
+void ec_fft_inner(g1::element* g1_elements, const size_t n, const std::vector<fr*>& root_table)
 {
-    is_power_of_two(n);
-    ASSERT(!root_table.empty());
+    ASSERT(n <= 2 || !root_table.empty());
+    fft(g1_elements, n, table_twiddles{ root_table }, nullptr);
+}
 
-    // Exercise: implement the butterfly structure to perform ec-fft
+void ec_fft_inner_direct(g1::element* g1_elements, const size_t n, const std::vector<fr*>& root_table)
+{
+    ASSERT(is_power_of_two(n) && (n <= 2 || !root_table.empty()));
+    fft_direct(g1_elements, n, table_twiddles{ root_table }, nullptr);
 }
 
+void ec_fft_inner_four_step(g1::element* g1_elements, const size_t n, const std::vector<fr*>& root_table)
+{
+    ASSERT(is_power_of_two(n) && n >= 4 && !root_table.empty());
+    fft_four_step(g1_elements, n, table_twiddles{ root_table }, nullptr);
+}
+
+/**
+ * The twiddles come from the domain's `twiddle_cache`, so that the butterflies only do the point side of their scalar
+ * multiplications.
+ */
 void ec_fft(g1::element* g1_elements, const evaluation_domain& domain)
 {
-    ec_fft_inner(g1_elements, domain.size, domain.get_round_roots());
+    fft(g1_elements, domain.size, cached_twiddles{ *twiddle_cache::get(domain), false }, nullptr);
 }
 
+// The scaling by 1/n rides on the twiddles, rather than taking a pass of its own.
 void ec_ifft(g1::element* g1_elements, const evaluation_domain& domain)
 {
-    ec_fft_inner(g1_elements, domain.size, domain.get_inverse_round_roots());
-    for (size_t i = 0; i < domain.size; i++) {
-        g1_elements[i] *= domain.domain_inverse;
-    }
+    const auto cache = twiddle_cache::get(domain);
+    fft(g1_elements, domain.size, cached_twiddles{ *cache, true }, cache.get());
 }
 
+void ec_fft_affine(g1::affine_element* points, const evaluation_domain& domain)
+{
+    ASSERT(is_power_of_two(domain.size));
+    bit_reverse(points, domain.size);
+    fft_affine_from_bit_reversed<cached_twiddles>(
+        { { points, domain.size, cached_twiddles{ *twiddle_cache::get(domain), false }, nullptr } });
+}
+
+void ec_ifft_affine(g1::affine_element* points, const evaluation_domain& domain)
+{
+    ASSERT(is_power_of_two(domain.size));
+    const auto cache = twiddle_cache::get(domain);
+    bit_reverse(points, domain.size);
+    fft_affine_from_bit_reversed<cached_twiddles>(
+        { { points, domain.size, cached_twiddles{ *cache, true }, cache.get() } });
+}
+
+/**
+ * If e = fft(c) are the evaluations of a polynomial with coefficients c, then c = ifft(e), and
+ *
+ *   Σ cᵢ[xⁱ]₁ = Σᵢ (1/n) Σₖ eₖ ω⁻ⁱᵏ [xⁱ]₁ = Σₖ eₖ [Lₖ(x)]₁   with   [Lₖ(x)]₁ = (1/n) Σᵢ ω⁻ⁱᵏ [xⁱ]₁,
+ *
+ * so the Lagrange SRS is the EC-iFFT of the monomial SRS.
+ */
 void convert_srs(g1::affine_element* monomial_srs, g1::affine_element* lagrange_srs, const evaluation_domain& domain)
 {
     const size_t n = domain.size;
-    is_power_of_two(n);
+    ASSERT(is_power_of_two(n));
+
+    // The copy into `lagrange_srs` doubles as the bit-reversal, and the affine transform leaves the points affine, so
+    // no pass over the points is left but the butterflies.
+    const auto cache = twiddle_cache::get(domain);
+    bit_reverse_copy(monomial_srs, lagrange_srs, n);
+    fft_affine_from_bit_reversed<cached_twiddles>(
+        { { lagrange_srs, n, cached_twiddles{ *cache, true }, cache.get() } });
+}
 
-    // Exercise: implement the conversion of monomial to Lagrange SRS
-    // Note that you can convert from g1::affine_element form to g1::element by just doing:
-    // g1::affine_element x_affine = g1::affine_one;
-    // auto x_elem = g1::element(x_affine);
-    // Conversion from g1::element to g1::affine_element can be done similarly.
+/**
+ * The Lagrange SRS of a domain of size n is the transform of the first n monomial points, which is no part of the
+ * transform of the first 2n: the sub-transforms of an FFT are over strided points, not prefixes. So each size takes a
+ * transform of its own, and the sharing is in running them: one batch of affine transforms, largest first, in lockstep
+ * on all the threads. For sizes 2^a to 2^b, the transforms take Σ 2^(k-1) k < 2 · 2^(b-1) b butterflies, less than
+ * twice the largest conversion alone. The roots of the smaller domains are powers of the largest one's, so every
+ * transform takes its twiddles, and its 1/n scaling up to a few doublings, from the largest domain's cache.
+ */
+std::vector<std::span<g1::affine_element>> convert_srs(g1::affine_element* monomial_srs,
+                                                       g1::affine_element* lagrange_srs,
+                                                       const std::vector<evaluation_domain>& domains)
+{
+    std::vector<std::span<g1::affine_element>> result;
+    if (domains.empty()) {
+        return result;
+    }
+    const auto& largest = *std::max_element(
+        domains.begin(), domains.end(), [](const auto& a, const auto& b) { return a.size < b.size; });
+    const auto cache = twiddle_cache::get(largest);
+    g1::affine_element* next = lagrange_srs;
+    for (const auto& domain : domains) {
+        ASSERT(is_power_of_two(domain.size) && domain.root == largest.root.pow(largest.size / domain.size));
+        result.emplace_back(next, domain.size);
+        bit_reverse_copy(monomial_srs, next, domain.size);
+        next += domain.size;
+    }
+
+    std::vector<size_t> order(domains.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return domains[a].size > domains[b].size; });
+    std::vector<affine_transform<cached_twiddles>> transforms;
+    for (size_t i : order) {
+        transforms.push_back({ result[i].data(), domains[i].size, cached_twiddles{ *cache, true }, cache.get() });
+    }
+    fft_affine_from_bit_reversed(transforms);
+    return result;
 }
 
 } // namespace g1_fft
-} // namespace waffle
\ No newline at end of file
+} // namespace waffle
@@ -1,7 +1,11 @@
 #pragma once
 #include <polynomials/evaluation_domain.hpp>
 #include <ecc/curves/bn254/g1.hpp>
+#include <ecc/curves/bn254/scalar_multiplication/scalar_multiplication.hpp>
 #include <numeric/bitop/get_msb.hpp>
+#include <span>
+#include <string>
+#include <vector>
 
 namespace waffle {
 namespace g1_fft {
@@ -26,6 +30,18 @@ using namespace barretenberg;
  */
 void ec_fft_inner(g1::element* g1_elements, const size_t n, const std::vector<fr*>& root_table);
 
+/**
+ * The engine `ec_fft_inner` uses for small transforms: a radix-2 FFT over the whole array, whose first rounds run as
+ * independent cache-sized sub-FFTs.
+ */
+void ec_fft_inner_direct(g1::element* g1_elements, const size_t n, const std::vector<fr*>& root_table);
+
+/**
+ * The engine `ec_fft_inner` uses for large transforms: a four-step FFT built from √n-sized sub-FFTs, which streams the
+ * points through memory twice whatever n is. Same inputs and results as `ec_fft_inner_direct`; n must be at least 4.
+ */
+void ec_fft_inner_four_step(g1::element* g1_elements, const size_t n, const std::vector<fr*>& root_table);
+
 /**
  * Computes EC-FFT of `g1_elements` given the evaluation domain `domain`.
  *
@@ -43,7 +59,16 @@ void ec_fft(g1::element* g1_elements, const evaluation_domain& domain);
 void ec_ifft(g1::element* g1_elements, const evaluation_domain& domain);
 
 /**
- * Using `ec_fft`, computes the Lagrange form of the SRS given the monomial form SRS `monomial_srs`.
+ * `ec_fft` and `ec_ifft` for affine points, which stay affine from round to round. The additions of each round share
+ * batched inversions, which makes them markedly cheaper than Jacobian additions and leaves nothing to normalise
+ * at the end.
+ */
+void ec_fft_affine(g1::affine_element* points, const evaluation_domain& domain);
+
+void ec_ifft_affine(g1::affine_element* points, const evaluation_domain& domain);
+
+/**
+ * Using `ec_ifft_affine`, computes the Lagrange form of the SRS given the monomial form SRS `monomial_srs`.
  *
  * @param monomial_srs: Monomial SRS of the form: ([1]₁, [x]₁, [x²]₁, [x³]₁, ..., [xⁿ⁻¹]₁)
  * @param lagrange_srs: Result must be stored in this, it should be of the form: ([L₀(x)]₁, [L₁(x)]₁, ..., [Lⁿ⁻¹(x)]₁)
@@ -51,5 +76,49 @@ void ec_ifft(g1::element* g1_elements, const evaluation_domain& domain);
  */
 void convert_srs(g1::affine_element* monomial_srs, g1::affine_element* lagrange_srs, const evaluation_domain& domain);
 
+/**
+ * `convert_srs` for several domains in one job, from the same monomial SRS. `lagrange_srs` receives the Lagrange SRS
+ * of each domain in turn, and must have room for the sum of their sizes; the result holds the span of each, in the
+ * order of `domains`. The work is less than twice that of the largest conversion alone, however many smaller sizes
+ * come with it. Only the largest domain's lookup table must be computed.
+ */
+std::vector<std::span<g1::affine_element>> convert_srs(g1::affine_element* monomial_srs,
+                                                       g1::affine_element* lagrange_srs,
+                                                       const std::vector<evaluation_domain>& domains);
+
+/**
+ * [Lₖ(x)]₁ for each k in `indices`, without the rest of the Lagrange SRS. Each is computed directly as the MSM
+ * Σᵢ (ω⁻ⁱᵏ/n)[xⁱ]₁ over the monomial SRS, with pippenger, as long as the MSMs cost less than a full `convert_srs`. For
+ * more points than that, the whole Lagrange SRS is converted and the points picked out of it, for which the domain's
+ * lookup table must be computed.
+ *
+ * @param monomial_point_table: Pippenger point table of the first n monomial points (2n entries), as made by
+ * `scalar_multiplication::generate_pippenger_point_table`
+ * @param state: Pippenger runtime state for n points
+ */
+std::vector<g1::affine_element> lagrange_commitments(g1::affine_element* monomial_point_table,
+                                                     const std::vector<size_t>& indices,
+                                                     const evaluation_domain& domain,
+                                                     scalar_multiplication::pippenger_runtime_state& state);
+
+#ifndef __wasm__
+// The default memory budget of the streaming `convert_srs`, 1 GiB.
+constexpr size_t STREAMING_MEMORY_BUDGET = 1UL << 30;
+
+/**
+ * `convert_srs` for SRS files larger than memory. `monomial_path` holds the monomial SRS as n raw
+ * `g1::affine_element`s, as laid out in memory, and the Lagrange SRS is written to `lagrange_path` in the same layout.
+ *
+ * The input is memory-mapped and transformed in two passes of a four-step decomposition, each streaming groups of
+ * √n-point lines through buffers that fit in `memory_budget` bytes; the intermediate result lives in a scratch file
+ * next to the output. Peak memory is about `memory_budget`, or a few √n-point lines per thread if that is more, and
+ * the domain's lookup table need not be computed. It needs mmap and threads, and is not built for WASM.
+ */
+void convert_srs(const std::string& monomial_path,
+                 const std::string& lagrange_path,
+                 const evaluation_domain& domain,
+                 size_t memory_budget = STREAMING_MEMORY_BUDGET);
+#endif
+
 } // namespace g1_fft
 } // namespace waffle
\ No newline at end of file
@@ -1,5 +1,12 @@
 #include "ec_fft.hpp"
+#include "bit_reverse.hpp"
+#include "srs_cache.hpp"
+#include "twiddle_cache.hpp"
+#include <cstdio>
 #include <gtest/gtest.h>
+#ifndef __wasm__
+#include <filesystem>
+#endif
 
 #include <ecc/curves/bn254/g1.hpp>
 #include <ecc/curves/bn254/g2.hpp>
@@ -11,6 +18,31 @@
 
 using namespace barretenberg;
 
+namespace {
+
+// A fake monomial SRS ([1]₁, [x]₁, [x²]₁, ..., [xⁿ⁻¹]₁) with secret `x`.
+std::vector<g1::affine_element> make_monomial_srs(size_t n, const fr& x)
+{
+    std::vector<g1::affine_element> monomial_srs;
+    fr power = 1;
+    for (size_t i = 0; i < n; i++) {
+        monomial_srs.push_back(g1::affine_element(g1::one * power));
+        power *= x;
+    }
+    return monomial_srs;
+}
+
+#ifndef __wasm__
+// A path in the temporary directory that only the running test uses, so that tests run in parallel do not collide.
+std::string temp_path(const std::string& name)
+{
+    const auto* test = ::testing::UnitTest::GetInstance()->current_test_info();
+    return ::testing::TempDir() + "/" + test->test_suite_name() + "_" + test->name() + "_" + name;
+}
+#endif
+
+} // namespace
+
 TEST(ec_fft, test_fft_ifft)
 {
     constexpr size_t n = 256;
@@ -158,4 +190,268 @@ TEST(ec_fft, test_convert_srs)
     result = result.normalize();
 
     EXPECT_EQ(result, expected);
-}
\ No newline at end of file
+}
+
+TEST(ec_fft, test_four_step_matches_direct)
+{
+    // Both an even and an odd log2(n), so that the four-step engine sees square and non-square splits.
+    for (size_t n : { 256UL, 512UL }) {
+        std::vector<g1::element> direct_points;
+        for (size_t i = 0; i < n; i++) {
+            direct_points.push_back(g1::one * fr::random_element());
+        }
+        std::vector<g1::element> four_step_points(direct_points);
+
+        auto domain = evaluation_domain(n);
+        domain.compute_lookup_table();
+
+        waffle::g1_fft::ec_fft_inner_direct(&direct_points[0], n, domain.get_round_roots());
+        waffle::g1_fft::ec_fft_inner_four_step(&four_step_points[0], n, domain.get_round_roots());
+
+        for (size_t i = 0; i < n; i++) {
+            EXPECT_EQ(direct_points[i].normalize(), four_step_points[i].normalize());
+        }
+    }
+}
+
+TEST(ec_fft, test_four_step_fft_ifft)
+{
+    // Large enough for ec_fft and ec_ifft to take the four-step engine, with cached twiddles and, for the inverse,
+    // the 1/n scaling folded into them.
+    constexpr size_t n = 1UL << 14;
+    std::vector<g1::element> monomial_points;
+    for (size_t i = 0; i < n; i++) {
+        monomial_points.push_back(g1::one * fr::random_element());
+    }
+    std::vector<g1::element> points(monomial_points);
+
+    auto domain = evaluation_domain(n);
+    domain.compute_lookup_table();
+
+    waffle::g1_fft::ec_fft(&points[0], domain);
+    waffle::g1_fft::ec_ifft(&points[0], domain);
+
+    for (size_t i = 0; i < n; i++) {
+        EXPECT_EQ(monomial_points[i].normalize(), points[i].normalize());
+    }
+}
+
+TEST(ec_fft, test_twiddle_cache)
+{
+    constexpr size_t n = 256;
+    auto domain = evaluation_domain(n);
+    domain.compute_lookup_table();
+    const auto cache = waffle::g1_fft::twiddle_cache::get(domain);
+    EXPECT_EQ(cache, waffle::g1_fft::twiddle_cache::get(domain));
+    waffle::g1_fft::twiddle_cache::release(n);
+    EXPECT_NE(cache, waffle::g1_fft::twiddle_cache::get(domain));
+
+    for (size_t i = 0; i < 16; i++) {
+        const g1::element point = g1::one * fr::random_element();
+        const fr scalar = fr::random_element();
+        EXPECT_EQ((point * scalar).normalize(), waffle::g1_fft::mul(point, waffle::g1_fft::recode(scalar)).normalize());
+    }
+
+    const g1::element point = g1::one * fr::random_element();
+    fr power = 1;
+    for (size_t t = 0; t < n; t++) {
+        EXPECT_EQ((point * power).normalize(), cache->mul(point, t, false).normalize());
+        EXPECT_EQ((point * power.invert()).normalize(), cache->mul(point, t, true).normalize());
+        power *= domain.root;
+    }
+}
+
+TEST(ec_fft, test_affine_fft_ifft)
+{
+    constexpr size_t n = 256;
+    std::vector<g1::element> points;
+    for (size_t i = 0; i < n; i++) {
+        points.push_back(g1::one * fr::random_element());
+    }
+    // After the bit-reversal, points i and i + n/2 meet in the first round. Equal, opposite and infinite points have no
+    // affine slope, and take the Jacobian fallback.
+    points[n / 2] = points[0];
+    points[n / 2 + 1] = -points[1];
+    points[2].self_set_infinity();
+
+    std::vector<g1::affine_element> affine_points;
+    for (size_t i = 0; i < n; i++) {
+        affine_points.push_back(g1::affine_element(points[i]));
+    }
+
+    auto domain = evaluation_domain(n);
+    domain.compute_lookup_table();
+
+    waffle::g1_fft::ec_fft(&points[0], domain);
+    waffle::g1_fft::ec_fft_affine(&affine_points[0], domain);
+    for (size_t i = 0; i < n; i++) {
+        EXPECT_EQ(g1::affine_element(points[i]), affine_points[i]);
+    }
+
+    waffle::g1_fft::ec_ifft(&points[0], domain);
+    waffle::g1_fft::ec_ifft_affine(&affine_points[0], domain);
+    for (size_t i = 0; i < n; i++) {
+        EXPECT_EQ(g1::affine_element(points[i]), affine_points[i]);
+    }
+}
+
+TEST(ec_fft, test_bit_reverse)
+{
+    // Below and above the size from which the permutation is blocked, with an odd and an even number of middle bits.
+    for (size_t log_n = 1; log_n <= 11; log_n++) {
+        const size_t n = 1UL << log_n;
+        std::vector<size_t> values(n);
+        for (size_t i = 0; i < n; i++) {
+            values[i] = i;
+        }
+        std::vector<size_t> copy(n);
+        waffle::g1_fft::bit_reverse_copy(&values[0], &copy[0], n);
+        waffle::g1_fft::bit_reverse(&values[0], n);
+
+        for (size_t i = 0; i < n; i++) {
+            const size_t expected =
+                waffle::g1_fft::reverse_bits(static_cast<uint32_t>(i), static_cast<uint32_t>(log_n));
+            EXPECT_EQ(values[i], expected);
+            EXPECT_EQ(copy[i], expected);
+        }
+    }
+}
+
+// The file-backed conversions are not built for WASM.
+#ifndef __wasm__
+TEST(ec_fft, test_convert_srs_streaming)
+{
+    const std::string monomial_path = temp_path("monomial_srs");
+    const std::string lagrange_path = temp_path("lagrange_srs");
+
+    // Below the four-step split, then square and non-square splits; a budget of one line per group, and of all of them.
+    for (size_t n : { 2UL, 64UL, 128UL }) {
+        auto monomial_srs = make_monomial_srs(n, fr::random_element());
+        FILE* file = fopen(monomial_path.c_str(), "wb");
+        ASSERT_NE(file, nullptr);
+        ASSERT_EQ(fwrite(&monomial_srs[0], sizeof(g1::affine_element), n, file), n);
+        fclose(file);
+
+        auto domain = evaluation_domain(n);
+        domain.compute_lookup_table();
+        std::vector<g1::affine_element> expected(n);
+        waffle::g1_fft::convert_srs(&monomial_srs[0], &expected[0], domain);
+
+        for (size_t memory_budget : { 0UL, waffle::g1_fft::STREAMING_MEMORY_BUDGET }) {
+            waffle::g1_fft::convert_srs(monomial_path, lagrange_path, domain, memory_budget);
+
+            std::vector<g1::affine_element> lagrange_srs(n);
+            file = fopen(lagrange_path.c_str(), "rb");
+            ASSERT_NE(file, nullptr);
+            ASSERT_EQ(fread(&lagrange_srs[0], sizeof(g1::affine_element), n, file), n);
+            fclose(file);
+            for (size_t i = 0; i < n; i++) {
+                EXPECT_EQ(lagrange_srs[i], expected[i]);
+            }
+        }
+    }
+    std::remove(monomial_path.c_str());
+    std::remove(lagrange_path.c_str());
+}
+
+TEST(ec_fft, test_lagrange_srs_cache)
+{
+    constexpr size_t n = 64;
+    const std::string directory = temp_path("cache");
+    std::filesystem::create_directories(directory);
+    const fr x = fr::random_element();
+    auto monomial_srs = make_monomial_srs(n, x);
+    auto domain = evaluation_domain(n);
+    domain.compute_lookup_table();
+    std::vector<g1::affine_element> expected(n);
+    waffle::g1_fft::convert_srs(&monomial_srs[0], &expected[0], domain);
+
+    const waffle::g1_fft::lagrange_srs_cache cache(directory);
+    const std::string entry = cache.path(n, waffle::g1_fft::hash_points(&monomial_srs[0], n));
+
+    // A miss converts and writes the entry, and a hit maps it; an entry whose points were corrupted is replaced.
+    for (size_t attempt = 0; attempt < 3; attempt++) {
+        if (attempt == 2) {
+            FILE* file = fopen(entry.c_str(), "r+b");
+            ASSERT_NE(file, nullptr);
+            const auto offset = static_cast<long>(sizeof(g1::affine_element));
+            fseek(file, offset, SEEK_SET);
+            const int byte = fgetc(file);
+            fseek(file, offset, SEEK_SET);
+            fputc(~byte, file);
+            fclose(file);
+        }
+        const auto lagrange_srs = cache.get(&monomial_srs[0], domain);
+        ASSERT_EQ(lagrange_srs.points().size(), n);
+        for (size_t i = 0; i < n; i++) {
+            EXPECT_EQ(lagrange_srs.points()[i], expected[i]);
+        }
+    }
+
+    // Another SRS of the same size is another entry.
+    monomial_srs[1] = g1::affine_element(g1::one * (x + 1));
+    EXPECT_NE(cache.path(n, waffle::g1_fft::hash_points(&monomial_srs[0], n)), entry);
+    std::filesystem::remove_all(directory);
+}
+#endif
+
+TEST(ec_fft, test_convert_srs_multiple_sizes)
+{
+    // Sizes out of order, with one below the affine chunk size and one above it, and a repeat. Only the largest domain
+    // has its lookup table.
+    const std::vector<size_t> sizes = { 64, 4096, 1, 256, 64 };
+    constexpr size_t max_n = 4096;
+    auto monomial_srs = make_monomial_srs(max_n, fr::random_element());
+
+    std::vector<evaluation_domain> domains;
+    size_t total = 0;
+    for (size_t n : sizes) {
+        domains.emplace_back(n);
+        if (n == max_n) {
+            domains.back().compute_lookup_table();
+        }
+        total += n;
+    }
+    std::vector<g1::affine_element> lagrange_srs(total);
+    const auto spans = waffle::g1_fft::convert_srs(&monomial_srs[0], &lagrange_srs[0], domains);
+
+    ASSERT_EQ(spans.size(), sizes.size());
+    for (size_t d = 0; d < sizes.size(); d++) {
+        ASSERT_EQ(spans[d].size(), sizes[d]);
+        auto domain = evaluation_domain(sizes[d]);
+        domain.compute_lookup_table();
+        std::vector<g1::affine_element> expected(sizes[d]);
+        waffle::g1_fft::convert_srs(&monomial_srs[0], &expected[0], domain);
+        for (size_t i = 0; i < sizes[d]; i++) {
+            EXPECT_EQ(spans[d][i], expected[i]);
+        }
+    }
+}
+
+TEST(ec_fft, test_lagrange_commitments)
+{
+    constexpr size_t n = 64;
+    auto monomial_srs = make_monomial_srs(n, fr::random_element());
+    auto domain = evaluation_domain(n);
+    domain.compute_lookup_table();
+    std::vector<g1::affine_element> expected(n);
+    waffle::g1_fft::convert_srs(&monomial_srs[0], &expected[0], domain);
+
+    monomial_srs.resize(2 * n);
+    scalar_multiplication::generate_pippenger_point_table(&monomial_srs[0], &monomial_srs[0], n);
+    scalar_multiplication::pippenger_runtime_state state(n);
+
+    // A few points go through MSMs, and all of them through the EC-FFT.
+    std::vector<size_t> few = { 0, n - 1, 5 };
+    std::vector<size_t> all(n);
+    for (size_t i = 0; i < n; i++) {
+        all[i] = n - 1 - i;
+    }
+    for (const auto& indices : { few, all }) {
+        const auto result = waffle::g1_fft::lagrange_commitments(&monomial_srs[0], indices, domain, state);
+        ASSERT_EQ(result.size(), indices.size());
+        for (size_t i = 0; i < indices.size(); i++) {
+            EXPECT_EQ(result[i], expected[indices[i]]);
+        }
+    }
+}
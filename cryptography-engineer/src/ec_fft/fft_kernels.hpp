@@ -0,0 +1,129 @@
+#pragma once
+#include "bit_reverse.hpp"
+#include "twiddle_cache.hpp"
+
+#ifndef NO_MULTITHREADING
+#include <omp.h>
+#endif
+
+namespace waffle {
+namespace g1_fft {
+
+// The building blocks the in-memory and streaming engines share: twiddle policies, and sub-FFTs run on one thread.
+
+inline bool is_power_of_two(uint64_t x)
+{
+    return x && !(x & (x - 1));
+}
+
+inline size_t get_num_threads()
+{
+#ifndef NO_MULTITHREADING
+    return static_cast<size_t>(omp_get_max_threads());
+#else
+    return 1;
+#endif
+}
+
+// The bit-reversal of a sub-FFT that is already in cache, on the calling thread.
+inline void bit_reverse_block(g1::element* g1_elements, const size_t n)
+{
+    const auto log2_n = static_cast<uint32_t>(numeric::get_msb(n));
+    for (size_t i = 0; i < n; ++i) {
+        const size_t swap_index = reverse_bits(static_cast<uint32_t>(i), log2_n);
+        if (i < swap_index) {
+            std::swap(g1_elements[i], g1_elements[swap_index]);
+        }
+    }
+}
+
+/**
+ * The engines take their twiddles as a callable `twiddles(point, m, j)`, returning `point * ω_{2m}^j` for the
+ * 2m-th root of unity ω_{2m} and j < 2m. These come from either the round tables of `ec_fft_inner`, or the recoded
+ * powers of a `twiddle_cache`.
+ */
+struct table_twiddles {
+    const std::vector<fr*>& root_table;
+
+    g1::element operator()(const g1::element& point, const size_t m, const size_t j) const
+    {
+        const fr* round_roots = root_table[numeric::get_msb(m) - 1];
+        return (j < m) ? point * round_roots[j] : -(point * round_roots[j - m]);
+    }
+};
+
+struct cached_twiddles {
+    const twiddle_cache& cache;
+    const bool inverse;
+
+    g1::element operator()(const g1::element& point, const size_t m, const size_t j) const
+    {
+        return cache.mul(point, j * (cache.size() / (2 * m)), inverse);
+    }
+};
+
+/**
+ * The butterfly of the round combining sub-FFTs of size m into sub-FFTs of size 2m, for the i-th of its n/2 pairs.
+ * A twiddle of 1 (the first pair of every sub-FFT) costs no scalar multiplication.
+ */
+template <typename Twiddles>
+inline void butterfly(g1::element* g1_elements, const Twiddles& twiddles, const size_t m, const size_t i)
+{
+    const size_t j = i & (m - 1);
+    const size_t k = ((i & ~(m - 1)) << 1) + j;
+    const g1::element t = (j == 0) ? g1_elements[k + m] : twiddles(g1_elements[k + m], m, j);
+    g1_elements[k + m] = g1_elements[k] - t;
+    g1_elements[k] += t;
+}
+
+/**
+ * Two rounds at once, combining sub-FFTs of size m into sub-FFTs of size 4m: for each group of four points
+ * a_r = x[k + j + r m], the pairs (a_0, a_1) and (a_2, a_3) are combined with twiddle ω_{2m}^j, and the results with
+ * ω_{4m}^j and ω_{4m}^{j+m}. This takes as many scalar multiplications as two radix-2 rounds, but one pass over the
+ * points instead of two.
+ */
+template <typename Twiddles>
+inline void radix4_round(g1::element* g1_elements, const size_t n, const size_t m, const Twiddles& twiddles)
+{
+    for (size_t k = 0; k < n; k += 4 * m) {
+        for (size_t j = 0; j < m; ++j) {
+            g1::element* a = g1_elements + k + j;
+            const g1::element t0 = (j == 0) ? a[m] : twiddles(a[m], m, j);
+            const g1::element t1 = (j == 0) ? a[3 * m] : twiddles(a[3 * m], m, j);
+            const g1::element b0 = a[0] + t0;
+            const g1::element b1 = a[0] - t0;
+            const g1::element b2 = a[2 * m] + t1;
+            const g1::element b3 = a[2 * m] - t1;
+            const g1::element u = (j == 0) ? b2 : twiddles(b2, 2 * m, j);
+            const g1::element v = twiddles(b3, 2 * m, j + m);
+            a[0] = b0 + u;
+            a[2 * m] = b0 - u;
+            a[m] = b1 + v;
+            a[3 * m] = b1 - v;
+        }
+    }
+}
+
+/**
+ * Every round of an FFT of `n` points already in bit-reversed order, on the calling thread: radix-4 rounds, preceded
+ * by one radix-2 round when log2(n) is odd.
+ */
+template <typename Twiddles>
+inline void fft_rounds(g1::element* g1_elements, const size_t n, const Twiddles& twiddles)
+{
+    size_t m = 1;
+    if (numeric::get_msb(n) & 1) {
+        for (size_t i = 0; i < n; i += 2) {
+            const g1::element t = g1_elements[i + 1];
+            g1_elements[i + 1] = g1_elements[i] - t;
+            g1_elements[i] += t;
+        }
+        m = 2;
+    }
+    for (; m < n; m <<= 2) {
+        radix4_round(g1_elements, n, m, twiddles);
+    }
+}
+
+} // namespace g1_fft
+} // namespace waffle
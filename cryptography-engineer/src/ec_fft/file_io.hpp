@@ -0,0 +1,122 @@
+#pragma once
+#ifndef __wasm__
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+namespace waffle {
+namespace g1_fft {
+
+inline std::runtime_error io_error(const std::string& what, const std::string& path)
+{
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+/**
+ * A shared mapping of a whole file, read-only unless `writable`.
+ */
+class mapped_file {
+  public:
+    mapped_file() = default;
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    mapped_file(mapped_file&& other) noexcept { swap(other); }
+    mapped_file& operator=(mapped_file&& other) noexcept
+    {
+        mapped_file tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+    ~mapped_file()
+    {
+        if (base_ != nullptr) {
+            munmap(base_, bytes_);
+        }
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    explicit mapped_file(const std::string& path, bool writable = false)
+        : path_(path)
+    {
+        fd_ = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+        if (fd_ < 0) {
+            throw io_error("open", path);
+        }
+        struct stat st;
+        if (fstat(fd_, &st) != 0) {
+            close_and_throw("stat");
+        }
+        bytes_ = static_cast<size_t>(st.st_size);
+        if (bytes_ == 0) {
+            return;
+        }
+        void* base = mmap(nullptr, bytes_, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd_, 0);
+        if (base == MAP_FAILED) {
+            close_and_throw("mmap");
+        }
+        base_ = static_cast<uint8_t*>(base);
+    }
+
+    uint8_t* data() const { return base_; }
+    size_t size() const { return bytes_; }
+    const std::string& path() const { return path_; }
+
+    /**
+     * Asks the kernel to start reading the `length` bytes from `offset` on, so that the faults of a strided gather
+     * overlap instead of waiting on the disk one page at a time.
+     */
+    void will_need(size_t offset, size_t length) const
+    {
+        const auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t begin = offset & ~(page_size - 1);
+        const size_t end = std::min(bytes_, offset + length);
+        if (begin < end) {
+            madvise(base_ + begin, end - begin, MADV_WILLNEED);
+        }
+    }
+
+    // Writes the mapping back, and the file to disk.
+    void sync() const
+    {
+        if ((base_ != nullptr && msync(base_, bytes_, MS_SYNC) != 0) || fsync(fd_) != 0) {
+            throw io_error("sync", path_);
+        }
+    }
+
+  private:
+    // For a constructor that fails after opening the file: the destructor will not run to close it.
+    [[noreturn]] void close_and_throw(const std::string& what)
+    {
+        const auto error = io_error(what, path_);
+        close(fd_);
+        fd_ = -1;
+        throw error;
+    }
+
+    void swap(mapped_file& other) noexcept
+    {
+        std::swap(path_, other.path_);
+        std::swap(fd_, other.fd_);
+        std::swap(base_, other.base_);
+        std::swap(bytes_, other.bytes_);
+    }
+
+    std::string path_;
+    int fd_ = -1;
+    uint8_t* base_ = nullptr;
+    size_t bytes_ = 0;
+};
+
+} // namespace g1_fft
+} // namespace waffle
+#endif
@@ -0,0 +1,90 @@
+#include "ec_fft.hpp"
+#include "fft_kernels.hpp"
+#include <algorithm>
+
+namespace waffle {
+namespace g1_fft {
+
+namespace {
+
+// The cost of a twiddle multiplication, in point additions: 127 doublings of about 0.7 additions each, and 32
+// additions, over the two GLV halves of a 4-bit window recoding.
+constexpr size_t TWIDDLE_COST = 120;
+
+/**
+ * Whether `count` MSMs of n points cost less than the EC-FFT of all n, in point additions. Pippenger adds each point
+ * and its endomorphism image into a bucket in each of its windows, of about log2(n) bits over 128-bit half scalars,
+ * then sums the buckets for about 2n more. The EC-FFT makes (n/2)·log2(n) twiddle multiplications. At n = 2^24, that
+ * puts the crossing at about a hundred points.
+ */
+bool prefer_msms(const size_t count, const size_t n)
+{
+    const size_t log2_n = std::max<size_t>(1, numeric::get_msb(n));
+    const size_t msm_cost = n * (2 + 2 * 128 / log2_n);
+    const size_t fft_cost = (n / 2) * log2_n * TWIDDLE_COST;
+    return count * msm_cost < fft_cost;
+}
+
+/**
+ * The scalars ω⁻ⁱᵏ/n of [Lₖ(x)]₁ = Σᵢ (ω⁻ⁱᵏ/n)[xⁱ]₁: each thread takes a range of i, starts it from a power, and goes
+ * on a multiplication at a time.
+ */
+void compute_lagrange_scalars(fr* scalars, const size_t k, const evaluation_domain& domain)
+{
+    const size_t n = domain.size;
+    const fr step = domain.root_inverse.pow(k);
+    const size_t num_threads = get_num_threads();
+    const size_t range = (n + num_threads - 1) / num_threads;
+#ifndef NO_MULTITHREADING
+#pragma omp parallel for
+#endif
+    for (size_t t = 0; t < num_threads; ++t) {
+        const size_t first = std::min(n, t * range);
+        const size_t last = std::min(n, first + range);
+        fr scalar = step.pow(first) * domain.domain_inverse;
+        for (size_t i = first; i < last; ++i) {
+            scalars[i] = scalar;
+            scalar *= step;
+        }
+    }
+}
+
+} // namespace
+
+std::vector<g1::affine_element> lagrange_commitments(g1::affine_element* monomial_point_table,
+                                                     const std::vector<size_t>& indices,
+                                                     const evaluation_domain& domain,
+                                                     scalar_multiplication::pippenger_runtime_state& state)
+{
+    const size_t n = domain.size;
+    ASSERT(is_power_of_two(n));
+    std::vector<g1::affine_element> result;
+    result.reserve(indices.size());
+
+    if (prefer_msms(indices.size(), n)) {
+        std::vector<fr> scalars(n);
+        for (size_t k : indices) {
+            ASSERT(k < n);
+            compute_lagrange_scalars(&scalars[0], k, domain);
+            result.push_back(g1::affine_element(
+                scalar_multiplication::pippenger(&scalars[0], monomial_point_table, n, state)));
+        }
+        return result;
+    }
+
+    // The monomial points are the even entries of the point table, between their endomorphism images.
+    std::vector<g1::affine_element> monomial_srs(n);
+    std::vector<g1::affine_element> lagrange_srs(n);
+    for (size_t i = 0; i < n; ++i) {
+        monomial_srs[i] = monomial_point_table[2 * i];
+    }
+    convert_srs(&monomial_srs[0], &lagrange_srs[0], domain);
+    for (size_t k : indices) {
+        ASSERT(k < n);
+        result.push_back(lagrange_srs[k]);
+    }
+    return result;
+}
+
+} // namespace g1_fft
+} // namespace waffle
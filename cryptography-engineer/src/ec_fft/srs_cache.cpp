@@ -0,0 +1,164 @@
+#ifndef __wasm__
+#include "srs_cache.hpp"
+#include "ec_fft.hpp"
+#include <array>
+#include <cstdio>
+#include <vector>
+
+namespace waffle {
+namespace g1_fft {
+
+namespace {
+
+constexpr std::array<char, 8> MAGIC = { 'L', 'A', 'G', 'R', 'S', 'R', 'S', '1' };
+
+// Points per chunk of `hash_points`: 1 MiB.
+constexpr size_t HASH_CHUNK_SIZE = 1UL << 14;
+
+// The header of a cache file, one point long, so that the points after it stay aligned.
+struct file_header {
+    std::array<char, 8> magic;
+    uint64_t size;
+    uint64_t monomial_hash;
+    uint64_t checksum;
+    std::array<uint64_t, 4> reserved;
+};
+static_assert(sizeof(file_header) == sizeof(g1::affine_element));
+
+// A multiply-xorshift step.
+inline uint64_t mix(uint64_t h, uint64_t word)
+{
+    h ^= word;
+    h *= 0x9e3779b97f4a7c15ULL;
+    return h ^ (h >> 29);
+}
+
+// Four independent lanes, so that the multiplications of consecutive words overlap.
+uint64_t hash_words(const uint64_t* words, size_t count, uint64_t seed)
+{
+    std::array<uint64_t, 4> lanes = { seed, seed + 1, seed + 2, seed + 3 };
+    for (size_t i = 0; i < count; ++i) {
+        lanes[i & 3] = mix(lanes[i & 3], words[i]);
+    }
+    uint64_t h = mix(seed, count);
+    for (uint64_t lane : lanes) {
+        h = mix(h, lane);
+    }
+    return h;
+}
+
+/**
+ * Maps the entry at `path` if it is valid for `n` and `monomial_hash`, and returns an unmapped file otherwise.
+ */
+mapped_file map_entry(const std::string& path, size_t n, uint64_t monomial_hash)
+{
+    if (access(path.c_str(), F_OK) != 0) {
+        return mapped_file();
+    }
+    mapped_file file(path);
+    if (file.size() != (n + 1) * sizeof(g1::affine_element)) {
+        return mapped_file();
+    }
+    file_header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    const auto* points = reinterpret_cast<const g1::affine_element*>(file.data()) + 1;
+    if (header.magic != MAGIC || header.size != n || header.monomial_hash != monomial_hash ||
+        header.checksum != hash_points(points, n)) {
+        return mapped_file();
+    }
+    return file;
+}
+
+/**
+ * Converts into a temporary file next to `path`, then renames it into place. The mapping of the temporary file is the
+ * one returned: after the rename, it maps the entry.
+ */
+mapped_file write_entry(const std::string& directory,
+                        const std::string& path,
+                        g1::affine_element* monomial_srs,
+                        const evaluation_domain& domain,
+                        uint64_t monomial_hash)
+{
+    const size_t n = domain.size;
+    std::string tmp = path + ".XXXXXX";
+    const int fd = mkstemp(&tmp[0]);
+    if (fd < 0) {
+        throw io_error("mkstemp", tmp);
+    }
+    const int rc = ftruncate(fd, static_cast<off_t>((n + 1) * sizeof(g1::affine_element)));
+    close(fd);
+    try {
+        if (rc != 0) {
+            throw io_error("ftruncate", tmp);
+        }
+        mapped_file file(tmp, true);
+        auto* points = reinterpret_cast<g1::affine_element*>(file.data()) + 1;
+        convert_srs(monomial_srs, points, domain);
+
+        const file_header header{ MAGIC, n, monomial_hash, hash_points(points, n), {} };
+        std::memcpy(file.data(), &header, sizeof(header));
+        file.sync();
+        if (rename(tmp.c_str(), path.c_str()) != 0) {
+            throw io_error("rename", tmp);
+        }
+        const int directory_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (directory_fd < 0) {
+            throw io_error("open", directory);
+        }
+        const int sync_rc = fsync(directory_fd);
+        close(directory_fd);
+        if (sync_rc != 0) {
+            throw io_error("fsync", directory);
+        }
+        return file;
+    } catch (...) {
+        unlink(tmp.c_str());
+        throw;
+    }
+}
+
+} // namespace
+
+uint64_t hash_points(const g1::affine_element* points, const size_t n)
+{
+    constexpr size_t words_per_point = sizeof(g1::affine_element) / sizeof(uint64_t);
+    const size_t num_chunks = (n + HASH_CHUNK_SIZE - 1) / HASH_CHUNK_SIZE;
+    std::vector<uint64_t> chunk_hashes(num_chunks);
+#ifndef NO_MULTITHREADING
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < num_chunks; ++i) {
+        const size_t count = std::min(HASH_CHUNK_SIZE, n - i * HASH_CHUNK_SIZE);
+        const auto* words = reinterpret_cast<const uint64_t*>(points + i * HASH_CHUNK_SIZE);
+        chunk_hashes[i] = hash_words(words, count * words_per_point, i);
+    }
+    return hash_words(chunk_hashes.data(), num_chunks, n);
+}
+
+std::span<const g1::affine_element> lagrange_srs::points() const
+{
+    return { reinterpret_cast<const g1::affine_element*>(file_.data()) + 1, n_ };
+}
+
+std::string lagrange_srs_cache::path(size_t n, uint64_t monomial_hash) const
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "/lagrange_%zu_%016llx.srs", n, static_cast<unsigned long long>(monomial_hash));
+    return directory_ + name;
+}
+
+lagrange_srs lagrange_srs_cache::get(g1::affine_element* monomial_srs, const evaluation_domain& domain) const
+{
+    const size_t n = domain.size;
+    const uint64_t monomial_hash = hash_points(monomial_srs, n);
+    const std::string entry = path(n, monomial_hash);
+    mapped_file file = map_entry(entry, n, monomial_hash);
+    if (file.data() == nullptr) {
+        file = write_entry(directory_, entry, monomial_srs, domain, monomial_hash);
+    }
+    return lagrange_srs(std::move(file), n);
+}
+
+} // namespace g1_fft
+} // namespace waffle
+#endif
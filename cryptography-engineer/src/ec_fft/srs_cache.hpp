@@ -0,0 +1,69 @@
+#pragma once
+#ifndef __wasm__
+#include "file_io.hpp"
+#include <polynomials/evaluation_domain.hpp>
+#include <ecc/curves/bn254/g1.hpp>
+#include <span>
+#include <string>
+
+namespace waffle {
+namespace g1_fft {
+
+using namespace barretenberg;
+
+/**
+ * A 64-bit hash of n points, for cache keys and checksums: it tells apart different SRS and catches corrupted files,
+ * but is not meant to stand up to anyone crafting collisions. The points are hashed in chunks, in parallel, and the
+ * chunk hashes hashed in turn, so the result does not depend on the number of threads.
+ */
+uint64_t hash_points(const g1::affine_element* points, size_t n);
+
+/**
+ * A Lagrange SRS held in a cache file, mapped into memory. Its points are read in place.
+ */
+class lagrange_srs {
+  public:
+    lagrange_srs(mapped_file file, size_t n)
+        : file_(std::move(file))
+        , n_(n)
+    {}
+
+    std::span<const g1::affine_element> points() const;
+
+  private:
+    mapped_file file_;
+    size_t n_;
+};
+
+/**
+ * A directory of Lagrange SRS, converted once and reused by every process that needs them. Like the other file-backed
+ * code here, it is not built for WASM.
+ *
+ * An entry is keyed by the domain size and the hash of the first n points of the monomial SRS, which are all that its
+ * conversion reads. Its file is a 64-byte header (magic, size, key hash, checksum of the points) followed by the n
+ * points as raw `g1::affine_element`s, so that it maps straight into memory; the format is that of the machine that
+ * wrote it, as the cache is local. Entries are written to a temporary file and renamed into place, so that readers
+ * never see one half-written, and concurrent writers of the same entry merely race to an identical result.
+ */
+class lagrange_srs_cache {
+  public:
+    explicit lagrange_srs_cache(std::string directory)
+        : directory_(std::move(directory))
+    {}
+
+    /**
+     * The Lagrange form of the first `domain.size` points of `monomial_srs`: mapped from the cache if it holds a valid
+     * entry, and otherwise converted with `convert_srs` (for which the domain's lookup table must be computed) and
+     * written back. Entries that fail their checks are converted again and replaced.
+     */
+    lagrange_srs get(g1::affine_element* monomial_srs, const evaluation_domain& domain) const;
+
+    std::string path(size_t n, uint64_t monomial_hash) const;
+
+  private:
+    std::string directory_;
+};
+
+} // namespace g1_fft
+} // namespace waffle
+#endif
@@ -0,0 +1,305 @@
+#ifndef __wasm__
+#include "ec_fft.hpp"
+#include "fft_kernels.hpp"
+#include "file_io.hpp"
+#include <array>
+#include <future>
+
+namespace waffle {
+namespace g1_fft {
+
+namespace {
+
+/**
+ * A file of points read and written at explicit offsets, from whichever thread.
+ */
+class points_file {
+  public:
+    points_file(const std::string& path, size_t num_points)
+        : path_(path)
+    {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) {
+            throw io_error("open", path);
+        }
+        if (ftruncate(fd_, static_cast<off_t>(num_points * sizeof(g1::affine_element))) != 0) {
+            close(fd_);
+            throw io_error("ftruncate", path);
+        }
+    }
+    points_file(const points_file&) = delete;
+    points_file& operator=(const points_file&) = delete;
+    ~points_file() { close(fd_); }
+
+    // Unlinks the file while it is open, so that its space goes back to the file system when it is closed.
+    void make_anonymous()
+    {
+        if (unlink(path_.c_str()) != 0) {
+            throw io_error("unlink", path_);
+        }
+    }
+
+    void write(const g1::affine_element* points, size_t count, size_t index) const
+    {
+        auto data = reinterpret_cast<const uint8_t*>(points);
+        size_t length = count * sizeof(g1::affine_element);
+        auto offset = static_cast<off_t>(index * sizeof(g1::affine_element));
+        while (length > 0) {
+            const ssize_t n = pwrite(fd_, data, length, offset);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw io_error("write", path_);
+            }
+            data += n;
+            length -= static_cast<size_t>(n);
+            offset += n;
+        }
+    }
+
+    void read(g1::affine_element* points, size_t count, size_t index) const
+    {
+        auto data = reinterpret_cast<uint8_t*>(points);
+        size_t length = count * sizeof(g1::affine_element);
+        auto offset = static_cast<off_t>(index * sizeof(g1::affine_element));
+        while (length > 0) {
+            const ssize_t n = pread(fd_, data, length, offset);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw io_error("read", path_);
+            }
+            if (n == 0) {
+                errno = EIO;
+                throw io_error("short read of", path_);
+            }
+            data += n;
+            length -= static_cast<size_t>(n);
+            offset += n;
+        }
+    }
+
+  private:
+    std::string path_;
+    int fd_ = -1;
+};
+
+/**
+ * The largest power of two, at most `num_lines`, of lines of `length` points that a pass can move per group within
+ * `memory_budget`: two groups of input and two of output are held at once, and each thread holds one line in
+ * Jacobian form while it transforms it.
+ */
+size_t lines_per_group(const size_t length, const size_t num_lines, const size_t memory_budget)
+{
+    const size_t per_line = 4 * length * sizeof(g1::affine_element);
+    const size_t per_thread = length * (sizeof(g1::element) + sizeof(fq));
+    const size_t fixed = get_num_threads() * per_thread;
+    size_t lines = 1;
+    while (lines < num_lines && fixed + 2 * lines * per_line <= memory_budget) {
+        lines <<= 1;
+    }
+    return lines;
+}
+
+/**
+ * Writes `points` in affine form to out[0], out[stride], ..., with one inversion for the lot. Points at infinity have
+ * no inverse z, and are left out of the batch.
+ */
+void to_affine(const g1::element* points, g1::affine_element* out, const size_t count, const size_t stride, fq* prefix)
+{
+    fq accumulator = fq::one();
+    for (size_t i = 0; i < count; ++i) {
+        prefix[i] = accumulator;
+        if (!points[i].is_point_at_infinity()) {
+            accumulator *= points[i].z;
+        }
+    }
+    accumulator = accumulator.invert();
+    for (size_t i = count - 1; i < count; --i) {
+        if (points[i].is_point_at_infinity()) {
+            out[i * stride] = g1::affine_element(points[i]);
+            continue;
+        }
+        const fq z_inverse = accumulator * prefix[i];
+        accumulator *= points[i].z;
+        const fq z_inverse_squared = z_inverse.sqr();
+        out[i * stride].x = points[i].x * z_inverse_squared;
+        out[i * stride].y = points[i].y * z_inverse_squared * z_inverse;
+    }
+}
+
+/**
+ * Runs `transform(group, input, output)` over `num_groups` groups of `group_size` points, with `load(group, input)`
+ * reading the next group and `store(group, output)` writing the previous one on threads of their own meanwhile.
+ */
+template <typename Load, typename Transform, typename Store>
+void run_pipeline(const size_t num_groups,
+                  const size_t group_size,
+                  const Load& load,
+                  const Transform& transform,
+                  const Store& store)
+{
+    std::array<std::vector<g1::affine_element>, 2> input;
+    std::array<std::vector<g1::affine_element>, 2> output;
+    for (size_t i = 0; i < 2; ++i) {
+        input[i].resize(group_size);
+        output[i].resize(group_size);
+    }
+
+    std::future<void> loading = std::async(std::launch::async, [&] { load(0, &input[0][0]); });
+    std::future<void> storing;
+    for (size_t group = 0; group < num_groups; ++group) {
+        loading.get();
+        if (group + 1 < num_groups) {
+            loading = std::async(std::launch::async, [&, group] { load(group + 1, &input[(group + 1) & 1][0]); });
+        }
+        transform(group, &input[group & 1][0], &output[group & 1][0]);
+        // The buffer the next transform writes to is free once the store before this one is done.
+        if (storing.valid()) {
+            storing.get();
+        }
+        storing = std::async(std::launch::async, [&, group] { store(group, &output[group & 1][0]); });
+    }
+    storing.get();
+}
+
+/**
+ * Calls `f(line, buffer, prefix)` for each of the `num_lines` lines of a group, spread over the threads, with `buffer`
+ * and `prefix` room for `length` points and field elements of the thread's own.
+ */
+template <typename F> void for_each_line(const size_t num_lines, const size_t length, const F& f)
+{
+#ifndef NO_MULTITHREADING
+#pragma omp parallel
+#endif
+    {
+        std::vector<g1::element> buffer(length);
+        std::vector<fq> prefix(length);
+#ifndef NO_MULTITHREADING
+#pragma omp for schedule(dynamic)
+#endif
+        for (size_t line = 0; line < num_lines; ++line) {
+            f(line, &buffer[0], &prefix[0]);
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * The four-step inverse transform of `fft_four_step`, with n = n₁n₂, out of core:
+ *   1. columns x[j₁ + n₁·] are gathered from the mapped input, a group of consecutive j₁ at a time, transformed, and
+ *      multiplied by ω^{-j₁k₂}/n, then written transposed to the scratch file, so that it holds rows k₂ contiguously;
+ *   2. rows are read back a group at a time, transformed, and scattered to X[k₂ + n₂k₁] in the output file.
+ * Points cross each pass in affine form, half the size of Jacobian points. The input and output of a group are runs of
+ * as many points as the group has lines: with the default budget, thousands of points, so the strided accesses still
+ * read and write whole pages.
+ *
+ * The sub-FFTs take their twiddles from the caches of √n-sized domains, whose roots are ω^{n₁} and ω^{n₂}; the twiddles
+ * of step 1 are consecutive powers, computed a field multiplication at a time. So nothing of size n is held in memory.
+ */
+void convert_srs(const std::string& monomial_path,
+                 const std::string& lagrange_path,
+                 const evaluation_domain& domain,
+                 const size_t memory_budget)
+{
+    const size_t n = domain.size;
+    ASSERT(is_power_of_two(n));
+
+    const mapped_file monomial(monomial_path);
+    const auto* monomial_points = reinterpret_cast<const g1::affine_element*>(monomial.data());
+    if (monomial.size() < n * sizeof(g1::affine_element)) {
+        errno = EINVAL;
+        throw io_error("too few points in", monomial_path);
+    }
+    points_file lagrange(lagrange_path, n);
+
+    if (n < 4) {
+        std::vector<g1::affine_element> monomial_srs(monomial_points, monomial_points + n);
+        std::vector<g1::affine_element> lagrange_srs(n);
+        convert_srs(&monomial_srs[0], &lagrange_srs[0], domain);
+        lagrange.write(&lagrange_srs[0], n, 0);
+        return;
+    }
+
+    const auto log2_n = static_cast<size_t>(numeric::get_msb(n));
+    const size_t n1 = 1UL << (log2_n / 2);
+    const size_t n2 = n / n1;
+    evaluation_domain column_domain(n2);
+    evaluation_domain row_domain(n1);
+    column_domain.compute_lookup_table();
+    row_domain.compute_lookup_table();
+    ASSERT(column_domain.root == domain.root.pow(n1) && row_domain.root == domain.root.pow(n2));
+    const auto column_cache = twiddle_cache::get(column_domain);
+    const auto row_cache = twiddle_cache::get(row_domain);
+
+    points_file scratch(lagrange_path + ".scratch", n);
+    scratch.make_anonymous();
+
+    // Step 1, a group of `columns` columns at a time. Group buffers hold entry (j₂, column) at j₂ * columns + column
+    // on the way in, and (k₂, column) at k₂ * columns + column on the way out.
+    const size_t columns = lines_per_group(n2, n1, memory_budget);
+    run_pipeline(
+        n1 / columns,
+        columns * n2,
+        [&](size_t group, g1::affine_element* input) {
+            const size_t first = group * columns;
+            for (size_t j2 = 0; j2 < n2; ++j2) {
+                monomial.will_need((first + n1 * j2) * sizeof(g1::affine_element),
+                                   columns * sizeof(g1::affine_element));
+            }
+            for (size_t j2 = 0; j2 < n2; ++j2) {
+                std::copy_n(monomial_points + first + n1 * j2, columns, input + j2 * columns);
+            }
+        },
+        [&](size_t group, const g1::affine_element* input, g1::affine_element* output) {
+            for_each_line(columns, n2, [&](size_t column, g1::element* points, fq* prefix) {
+                for (size_t j2 = 0; j2 < n2; ++j2) {
+                    points[j2] = g1::element(input[j2 * columns + column]);
+                }
+                bit_reverse_block(points, n2);
+                fft_rounds(points, n2, cached_twiddles{ *column_cache, true });
+                const fr step = domain.root_inverse.pow(group * columns + column);
+                fr twiddle = domain.domain_inverse;
+                for (size_t k2 = 0; k2 < n2; ++k2) {
+                    points[k2] = points[k2] * twiddle;
+                    twiddle *= step;
+                }
+                to_affine(points, output + column, n2, columns, prefix);
+            });
+        },
+        [&](size_t group, const g1::affine_element* output) {
+            for (size_t k2 = 0; k2 < n2; ++k2) {
+                scratch.write(output + k2 * columns, columns, k2 * n1 + group * columns);
+            }
+        });
+
+    // Step 2, a group of `rows` rows at a time. Group buffers hold entry (row, j₁) at row * n₁ + j₁ on the way in, and
+    // (k₁, row) at k₁ * rows + row on the way out.
+    const size_t rows = lines_per_group(n1, n2, memory_budget);
+    run_pipeline(
+        n2 / rows,
+        rows * n1,
+        [&](size_t group, g1::affine_element* input) { scratch.read(input, rows * n1, group * rows * n1); },
+        [&](size_t, const g1::affine_element* input, g1::affine_element* output) {
+            for_each_line(rows, n1, [&](size_t row, g1::element* points, fq* prefix) {
+                for (size_t j1 = 0; j1 < n1; ++j1) {
+                    points[j1] = g1::element(input[row * n1 + j1]);
+                }
+                bit_reverse_block(points, n1);
+                fft_rounds(points, n1, cached_twiddles{ *row_cache, true });
+                to_affine(points, output + row, n1, rows, prefix);
+            });
+        },
+        [&](size_t group, const g1::affine_element* output) {
+            for (size_t k1 = 0; k1 < n1; ++k1) {
+                lagrange.write(output + k1 * rows, rows, group * rows + n2 * k1);
+            }
+        });
+}
+
+} // namespace g1_fft
+} // namespace waffle
+#endif
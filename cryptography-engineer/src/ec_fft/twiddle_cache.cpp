@@ -0,0 +1,161 @@
+#include "twiddle_cache.hpp"
+#include <ecc/groups/wnaf.hpp>
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+namespace waffle {
+namespace g1_fft {
+
+namespace {
+
+// Odd multiples P, 3P, ..., 15P, enough for every 4-bit wNAF digit.
+constexpr size_t LOOKUP_SIZE = 1UL << (recoded_scalar::WNAF_BITS - 1);
+constexpr uint8_t SIGN_BIT = 0x80;
+
+// The caches built by `twiddle_cache::get`, by domain size, until `twiddle_cache::release`.
+std::mutex registry_mutex;
+std::map<size_t, std::shared_ptr<const twiddle_cache>> registry;
+
+} // namespace
+
+/**
+ * The same split and recoding as `element::mul_with_endomorphism`, with each wNAF entry packed into a byte.
+ */
+recoded_scalar recode(const fr& scalar)
+{
+    constexpr size_t num_entries = 2 * recoded_scalar::NUM_ROUNDS;
+    const fr converted_scalar = scalar.from_montgomery_form();
+    ASSERT(!converted_scalar.is_zero());
+
+    // Only the low two limbs of each half are written, and read.
+    fr k1 = fr::zero();
+    fr k2 = fr::zero();
+    fr::split_into_endomorphism_scalars(converted_scalar, k1, k2);
+
+    recoded_scalar result;
+    uint64_t wnaf_table[num_entries];
+    wnaf::fixed_wnaf(&k1.data[0], &wnaf_table[0], result.skew, 0, 2, recoded_scalar::WNAF_BITS);
+    wnaf::fixed_wnaf(&k2.data[0], &wnaf_table[1], result.endo_skew, 0, 2, recoded_scalar::WNAF_BITS);
+    for (size_t i = 0; i < num_entries; ++i) {
+        const auto index = static_cast<uint8_t>(wnaf_table[i] & 0x0fffffffU);
+        const bool sign = static_cast<bool>((wnaf_table[i] >> 31) & 1);
+        result.digits[i] = static_cast<uint8_t>(index | (sign ? SIGN_BIT : 0));
+    }
+    return result;
+}
+
+/**
+ * As in `element::mul_with_endomorphism`, the odd multiples are normalised with one shared inversion, which every
+ * addition of the main loop repays by being a mixed one.
+ */
+g1::element mul(const g1::element& point, const recoded_scalar& scalar)
+{
+    if (point.is_point_at_infinity()) {
+        return point;
+    }
+    std::array<g1::element, LOOKUP_SIZE> precomputed;
+    const g1::element d2 = point.dbl();
+    precomputed[0] = point;
+    for (size_t i = 1; i < LOOKUP_SIZE; ++i) {
+        precomputed[i] = precomputed[i - 1] + d2;
+    }
+    g1::element::batch_normalize(&precomputed[0], LOOKUP_SIZE);
+    std::array<g1::affine_element, LOOKUP_SIZE> lookup_table;
+    for (size_t i = 0; i < LOOKUP_SIZE; ++i) {
+        lookup_table[i] = g1::affine_element(precomputed[i].x, precomputed[i].y);
+    }
+
+    const fq beta = fq::cube_root_of_unity();
+    g1::element result = point;
+    result.self_set_infinity();
+    for (size_t i = 0; i < 2 * recoded_scalar::NUM_ROUNDS; ++i) {
+        const uint8_t digit = scalar.digits[i];
+        const bool is_odd = ((i & 1) == 1);
+        g1::affine_element to_add = lookup_table[digit & (SIGN_BIT - 1)];
+        // Odd entries are digits of k₂, which is subtracted after the endomorphism (x, y) -> (βx, y) maps P to λP.
+        to_add.y.self_conditional_negate(((digit & SIGN_BIT) != 0) ^ is_odd);
+        if (is_odd) {
+            to_add.x *= beta;
+        }
+        result += to_add;
+        if (is_odd && i != 2 * recoded_scalar::NUM_ROUNDS - 1) {
+            for (size_t j = 0; j < recoded_scalar::WNAF_BITS; ++j) {
+                result.self_dbl();
+            }
+        }
+    }
+
+    if (scalar.skew) {
+        result += -lookup_table[0];
+    }
+    if (scalar.endo_skew) {
+        result += g1::affine_element(lookup_table[0].x * beta, lookup_table[0].y);
+    }
+    return result;
+}
+
+std::shared_ptr<const twiddle_cache> twiddle_cache::get(const evaluation_domain& domain)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto& cache = registry[domain.size];
+    if (!cache) {
+        cache = std::shared_ptr<const twiddle_cache>(new twiddle_cache(domain));
+    }
+    return cache;
+}
+
+void twiddle_cache::release(const size_t n)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    registry.erase(n);
+}
+
+/**
+ * The last round of the domain's lookup table holds exactly ω⁰ ... ω^{n/2-1}, and ω⁻ʲ = -ω^{n/2-j} for 0 < j < n/2.
+ * Domains of size 1 and 2 have no rounds, and their transforms no twiddles but ω⁰.
+ */
+twiddle_cache::twiddle_cache(const evaluation_domain& domain)
+    : n_(domain.size)
+    , powers_(std::max<size_t>(1, domain.size / 2))
+    , inverse_scaled_powers_(powers_.size())
+    , scale_(recode(domain.domain_inverse))
+{
+    const auto& round_roots = domain.get_round_roots();
+    ASSERT(domain.size <= 2 || !round_roots.empty());
+    const fr* roots = round_roots.empty() ? nullptr : round_roots.back();
+    const size_t num_powers = powers_.size();
+#ifndef NO_MULTITHREADING
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < num_powers; ++i) {
+        powers_[i] = recode(roots ? roots[i] : fr::one());
+        const fr inverse_power = (i == 0) ? fr::one() : -roots[num_powers - i];
+        inverse_scaled_powers_[i] = recode(inverse_power * domain.domain_inverse);
+    }
+}
+
+// With ω^{n/2+t} = -ωᵗ, powers from n/2 on are negated powers from the first half.
+g1::element twiddle_cache::mul(const g1::element& point, size_t t, bool inverse) const
+{
+    ASSERT(t < n_);
+    const size_t exponent = (inverse && t != 0) ? n_ - t : t;
+    const size_t half = powers_.size();
+    if (exponent < half) {
+        return g1_fft::mul(point, powers_[exponent]);
+    }
+    return -g1_fft::mul(point, powers_[exponent - half]);
+}
+
+g1::element twiddle_cache::mul_inverse_scaled(const g1::element& point, size_t t) const
+{
+    ASSERT(t < n_);
+    const size_t half = inverse_scaled_powers_.size();
+    if (t < half) {
+        return g1_fft::mul(point, inverse_scaled_powers_[t]);
+    }
+    return -g1_fft::mul(point, inverse_scaled_powers_[t - half]);
+}
+
+} // namespace g1_fft
+} // namespace waffle
@@ -0,0 +1,88 @@
+#pragma once
+#include <polynomials/evaluation_domain.hpp>
+#include <ecc/curves/bn254/g1.hpp>
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace waffle {
+namespace g1_fft {
+
+using namespace barretenberg;
+
+/**
+ * A scalar split through the GLV endomorphism, k = k₁ - λk₂, with both halves recoded into fixed-window wNAF digits:
+ * the whole scalar-side half of `g1::element::operator*`, done ahead of time.
+ */
+struct recoded_scalar {
+    static constexpr size_t WNAF_BITS = 4;
+    // 4-bit windows over each 127-bit half scalar.
+    static constexpr size_t NUM_ROUNDS = 32;
+
+    // The digits of k₁ (even entries) and k₂ (odd entries), interleaved and most significant first. The low bits of a
+    // digit index an odd multiple of the point, and the top bit is its sign.
+    std::array<uint8_t, 2 * NUM_ROUNDS> digits;
+    bool skew;
+    bool endo_skew;
+};
+
+recoded_scalar recode(const fr& scalar);
+
+/**
+ * `point * scalar`, for a scalar recoded by `recode`: the point side of the endomorphism multiplication, with its
+ * affine lookup table and mixed additions.
+ */
+g1::element mul(const g1::element& point, const recoded_scalar& scalar);
+
+/**
+ * The recoded powers ω⁰, ω¹, ..., ω^{n/2-1} of the n-th root of unity of an evaluation domain. Up to sign, every
+ * twiddle of a forward or inverse EC-FFT of size n is one of those: ω^{-t} = ω^{n-t}, and ω^{n/2+t} = -ωᵗ.
+ *
+ * The cache also holds the recoded ω⁻ʲ/n, for j < n/2, so that inverse transforms can fold their scaling by 1/n into
+ * their twiddles.
+ *
+ * A cache is built once per domain size, on first use, and shared by every `ec_fft`, `ec_ifft` and `convert_srs` over
+ * domains of that size until `release`. It takes 66 bytes per power, about two thirds of the size of the points it
+ * multiplies.
+ */
+class twiddle_cache {
+  public:
+    /**
+     * The cache for domains of the size of `domain`, whose lookup table must be computed.
+     */
+    static std::shared_ptr<const twiddle_cache> get(const evaluation_domain& domain);
+
+    /**
+     * Drops the cache for domains of size n, if there is one: it is freed once nobody holds it, and the next `get`
+     * builds it again.
+     */
+    static void release(size_t n);
+
+    /**
+     * `point * ωᵗ`, or `point * ω⁻ᵗ` if `inverse`, for t < n.
+     */
+    g1::element mul(const g1::element& point, size_t t, bool inverse) const;
+
+    /**
+     * `point * ω⁻ᵗ / n`, for t < n.
+     */
+    g1::element mul_inverse_scaled(const g1::element& point, size_t t) const;
+
+    /**
+     * `point / n`.
+     */
+    g1::element scale(const g1::element& point) const { return g1_fft::mul(point, scale_); }
+
+    size_t size() const { return n_; }
+
+  private:
+    explicit twiddle_cache(const evaluation_domain& domain);
+
+    size_t n_;
+    std::vector<recoded_scalar> powers_;
+    std::vector<recoded_scalar> inverse_scaled_powers_;
+    recoded_scalar scale_;
+};
+
+} // namespace g1_fft
+} // namespace waffle
@@ -0,0 +1,318 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#ifndef __wasm__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace plonk {
+namespace stdlib {
+namespace indexed_merkle_tree {
+
+inline std::runtime_error io_error(std::string const& what, std::string const& path)
+{
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+#ifndef __wasm__
+/**
+ * The file side of a file-backed Column: a private mapping of a whole file, reserved up front at the largest size the
+ * file can reach so that it never moves, and the set of pages written since the last `clean`.
+ *
+ * The mapping is MAP_PRIVATE, so writes land in private copies of the pages and never reach the file on their own;
+ * whoever owns the file writes the dirty pages back explicitly (IndexedMerkleTree::persist does so through its
+ * journal). The file therefore only ever holds committed data, whatever the kernel decides to flush.
+ */
+class MappedFile {
+  public:
+    static constexpr size_t PAGE_SIZE = 4096;
+    // Files grow in steps of at least this much, to keep ftruncate calls rare.
+    static constexpr size_t GROWTH_BYTES = 1UL << 20;
+
+    MappedFile() = default;
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+    MappedFile(MappedFile&& other) noexcept { swap(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        MappedFile tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+    ~MappedFile()
+    {
+        if (base_ != nullptr) {
+            munmap(base_, mapped_bytes_);
+        }
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+    }
+
+    /**
+     * Opens (creating if needed) and maps `path` with room for `max_bytes`.
+     */
+    MappedFile(std::string const& path, size_t max_bytes)
+        : path_(path)
+        , mapped_bytes_(std::max(round_up(max_bytes, PAGE_SIZE), PAGE_SIZE))
+    {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd_ < 0) {
+            throw io_error("open", path);
+        }
+        struct stat st;
+        if (fstat(fd_, &st) != 0) {
+            close_and_throw("stat");
+        }
+        file_bytes_ = static_cast<size_t>(st.st_size);
+        void* base = mmap(nullptr, mapped_bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_NORESERVE, fd_, 0);
+        if (base == MAP_FAILED) {
+            close_and_throw("mmap");
+        }
+        base_ = static_cast<uint8_t*>(base);
+    }
+
+    bool is_open() const { return base_ != nullptr; }
+    uint8_t* data() const { return base_; }
+    int fd() const { return fd_; }
+    std::string const& path() const { return path_; }
+
+    /**
+     * Makes the first `bytes` of the mapping accessible, growing the file if it is shorter.
+     */
+    void reserve(size_t bytes)
+    {
+        if (bytes <= file_bytes_) {
+            return;
+        }
+        const size_t target = std::min(mapped_bytes_, round_up(std::max(bytes, file_bytes_ + GROWTH_BYTES), PAGE_SIZE));
+        if (ftruncate(fd_, static_cast<off_t>(target)) != 0) {
+            throw io_error("ftruncate", path_);
+        }
+        file_bytes_ = target;
+    }
+
+    void mark_dirty(size_t begin_byte, size_t end_byte)
+    {
+        if (begin_byte >= end_byte) {
+            return;
+        }
+        const size_t last_page = (end_byte - 1) / PAGE_SIZE;
+        if (dirty_.size() <= last_page) {
+            dirty_.resize(last_page + 1, false);
+        }
+        for (size_t page = begin_byte / PAGE_SIZE; page <= last_page; ++page) {
+            if (!dirty_[page]) {
+                dirty_[page] = true;
+                dirty_pages_.push_back(page);
+            }
+        }
+    }
+
+    /**
+     * Calls f(offset, bytes, length) for every dirty page, clipped to the first `live_bytes` of the file.
+     */
+    template <typename F> void for_each_dirty_page(size_t live_bytes, F&& f) const
+    {
+        for (size_t page : dirty_pages_) {
+            const size_t offset = page * PAGE_SIZE;
+            if (offset < live_bytes) {
+                f(offset, base_ + offset, std::min(PAGE_SIZE, live_bytes - offset));
+            }
+        }
+    }
+
+    /**
+     * Forgets the dirty pages once they are in the file, mapping the file's pages back in place of the private
+     * copies so that the memory they held can be reclaimed.
+     */
+    void clean()
+    {
+        for (size_t i = 0; i < dirty_pages_.size(); ++i) {
+            const size_t page = dirty_pages_[i];
+            const size_t offset = page * PAGE_SIZE;
+            if (offset < file_bytes_ && mmap(base_ + offset,
+                                             PAGE_SIZE,
+                                             PROT_READ | PROT_WRITE,
+                                             MAP_PRIVATE | MAP_FIXED | MAP_NORESERVE,
+                                             fd_,
+                                             static_cast<off_t>(offset)) == MAP_FAILED) {
+                // The pages not remapped yet keep their private copies, and stay dirty.
+                dirty_pages_.erase(dirty_pages_.begin(), dirty_pages_.begin() + static_cast<std::ptrdiff_t>(i));
+                throw io_error("mmap", path_);
+            }
+            dirty_[page] = false;
+        }
+        dirty_pages_.clear();
+    }
+
+  private:
+    static size_t round_up(size_t x, size_t multiple) { return (x + multiple - 1) / multiple * multiple; }
+
+    // For a constructor that fails after opening the file: the destructor will not run to close it.
+    [[noreturn]] void close_and_throw(std::string const& what)
+    {
+        const auto error = io_error(what, path_);
+        close(fd_);
+        fd_ = -1;
+        throw error;
+    }
+
+    void swap(MappedFile& other) noexcept
+    {
+        std::swap(path_, other.path_);
+        std::swap(fd_, other.fd_);
+        std::swap(base_, other.base_);
+        std::swap(mapped_bytes_, other.mapped_bytes_);
+        std::swap(file_bytes_, other.file_bytes_);
+        std::swap(dirty_, other.dirty_);
+        std::swap(dirty_pages_, other.dirty_pages_);
+    }
+
+    std::string path_;
+    int fd_ = -1;
+    uint8_t* base_ = nullptr;
+    size_t mapped_bytes_ = 0;
+    size_t file_bytes_ = 0;
+    std::vector<bool> dirty_;
+    std::vector<size_t> dirty_pages_;
+};
+#else
+// WASI has no mmap, so columns only ever live on the heap there: a file that is never open.
+class MappedFile {
+  public:
+    bool is_open() const { return false; }
+    uint8_t* data() const { return nullptr; }
+    void reserve(size_t) {}
+    void mark_dirty(size_t, size_t) {}
+};
+#endif
+
+/**
+ * A growable array of trivially copyable T, held either on the heap (the default) or in a MappedFile. Elements are
+ * read through `operator[]` and written through `set`, `resize` and `append`, so that a file-backed column knows which
+ * pages it has to write back. Copying a column always yields a heap column holding the same elements.
+ */
+template <typename T> class Column {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+  public:
+    Column() = default;
+    Column(Column const& other)
+        : heap_(other.begin(), other.end())
+        , data_(heap_.data())
+        , size_(heap_.size())
+    {}
+    Column& operator=(Column const& other)
+    {
+        if (this != &other) {
+            Column tmp(other);
+            swap(tmp);
+        }
+        return *this;
+    }
+    Column(Column&& other) noexcept { swap(other); }
+    Column& operator=(Column&& other) noexcept
+    {
+        Column tmp(std::move(other));
+        swap(tmp);
+        return *this;
+    }
+
+#ifndef __wasm__
+    /**
+     * A column over the file at `path`, with room for `capacity` elements, whose first `size` elements are live.
+     */
+    static Column map(std::string const& path, size_t capacity, size_t size)
+    {
+        Column column;
+        column.file_ = MappedFile(path, capacity * sizeof(T));
+        column.file_.reserve(size * sizeof(T));
+        column.data_ = reinterpret_cast<T*>(column.file_.data());
+        column.size_ = size;
+        return column;
+    }
+#endif
+
+    size_t size() const { return size_; }
+    const T& operator[](size_t index) const { return data_[index]; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+    operator std::span<const T>() const { return { data_, size_ }; }
+
+    void set(size_t index, T const& value)
+    {
+        data_[index] = value;
+        touch(index, index + 1);
+    }
+
+    void resize(size_t size, T const& fill)
+    {
+        if (!file_.is_open()) {
+            heap_.resize(size, fill);
+            data_ = heap_.data();
+        } else {
+            file_.reserve(size * sizeof(T));
+            std::fill(data_ + std::min(size, size_), data_ + size, fill);
+            touch(size_, size);
+        }
+        size_ = size;
+    }
+
+    void append(const T* first, const T* last)
+    {
+        const size_t old_size = size_;
+        const size_t count = static_cast<size_t>(last - first);
+        if (!file_.is_open()) {
+            heap_.insert(heap_.end(), first, last);
+            data_ = heap_.data();
+        } else {
+            file_.reserve((old_size + count) * sizeof(T));
+            std::copy(first, last, data_ + old_size);
+            touch(old_size, old_size + count);
+        }
+        size_ = old_size + count;
+    }
+
+    bool operator==(Column const& other) const { return std::equal(begin(), end(), other.begin(), other.end()); }
+
+    // Null for heap columns.
+    MappedFile* file() { return file_.is_open() ? &file_ : nullptr; }
+
+  private:
+    void touch(size_t begin, size_t end)
+    {
+        if (file_.is_open() && begin < end) {
+            file_.mark_dirty(begin * sizeof(T), end * sizeof(T));
+        }
+    }
+
+    void swap(Column& other) noexcept
+    {
+        std::swap(file_, other.file_);
+        std::swap(heap_, other.heap_);
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+    }
+
+    MappedFile file_;
+    std::vector<T> heap_;
+    T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace indexed_merkle_tree
+} // namespace stdlib
+} // namespace plonk
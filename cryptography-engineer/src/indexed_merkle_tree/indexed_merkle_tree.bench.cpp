@@ -0,0 +1,109 @@
+#include "indexed_merkle_tree.hpp"
+#include <benchmark/benchmark.h>
+
+using namespace benchmark;
+using namespace barretenberg;
+using namespace plonk::stdlib::indexed_merkle_tree;
+
+namespace {
+
+// Leaves in the trees that inserts and lookups are measured against.
+constexpr size_t PREFILLED_LEAVES = 1 << 12;
+
+std::vector<fr> random_values(size_t count)
+{
+    std::vector<fr> values(count);
+    for (auto& value : values) {
+        value = fr::random_element();
+    }
+    return values;
+}
+
+IndexedMerkleTree prefilled_tree(size_t depth)
+{
+    IndexedMerkleTree tree(depth);
+    tree.update_elements(random_values(PREFILLED_LEAVES - 1));
+    return tree;
+}
+
+void construct(State& state) noexcept
+{
+    const auto depth = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        IndexedMerkleTree tree(depth);
+        DoNotOptimize(tree.root());
+    }
+}
+BENCHMARK(construct)->DenseRange(16, 32, 8)->Unit(kMicrosecond);
+
+void update_element(State& state) noexcept
+{
+    auto tree = prefilled_tree(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        DoNotOptimize(tree.update_element(fr::random_element()));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(update_element)->DenseRange(20, 32, 12)->Unit(kMicrosecond);
+
+// Each batch is undone through a checkpoint, so every iteration inserts into the same tree.
+void update_elements(State& state) noexcept
+{
+    auto tree = prefilled_tree(static_cast<size_t>(state.range(0)));
+    const auto values = random_values(static_cast<size_t>(state.range(1)));
+    for (auto _ : state) {
+        tree.checkpoint();
+        DoNotOptimize(tree.update_elements(values).root);
+        state.PauseTiming();
+        tree.revert();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(1));
+}
+BENCHMARK(update_elements)
+    ->ArgsProduct({ { 20, 32 }, { 64, 1024 } })
+    ->ArgNames({ "depth", "batch" })
+    ->Unit(kMillisecond);
+
+void get_hash_path(State& state) noexcept
+{
+    const auto tree = prefilled_tree(static_cast<size_t>(state.range(0)));
+    size_t index = 0;
+    for (auto _ : state) {
+        DoNotOptimize(tree.get_hash_path(index));
+        index = (index + 1) % PREFILLED_LEAVES;
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(get_hash_path)->DenseRange(16, 32, 8);
+
+void get_low_leaf_witness(State& state) noexcept
+{
+    const auto tree = prefilled_tree(static_cast<size_t>(state.range(0)));
+    const auto queries = random_values(1024);
+    size_t i = 0;
+    for (auto _ : state) {
+        DoNotOptimize(tree.get_low_leaf_witness(queries[i]));
+        i = (i + 1) % queries.size();
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK(get_low_leaf_witness)->DenseRange(16, 32, 8);
+
+void get_low_leaf_witnesses(State& state) noexcept
+{
+    const auto tree = prefilled_tree(static_cast<size_t>(state.range(0)));
+    const auto queries = random_values(static_cast<size_t>(state.range(1)));
+    for (auto _ : state) {
+        DoNotOptimize(tree.get_low_leaf_witnesses(queries));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * state.range(1));
+}
+BENCHMARK(get_low_leaf_witnesses)
+    ->ArgsProduct({ { 16, 32 }, { 1024 } })
+    ->ArgNames({ "depth", "queries" })
+    ->Unit(kMicrosecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
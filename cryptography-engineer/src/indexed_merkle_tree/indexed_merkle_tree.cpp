@@ -1,5 +1,6 @@
 #include "indexed_merkle_tree.hpp"
 #include <stdlib/merkle_tree/hash.hpp>
+#include <algorithm>
 
 namespace plonk {
 namespace stdlib {
@@ -7,50 +8,456 @@ namespace indexed_merkle_tree {
 
 /**
  * Initialise an indexed merkle tree state with all the leaf values: H({0, 0, 0}).
- * Note that the leaf pre-image vector `leaves_` must be filled with {0, 0, 0} only at index 0.
+ * Note that the leaf pre-image store `leaves_` must be filled with {0, 0, 0} only at index 0.
  */
-IndexedMerkleTree::IndexedMerkleTree(size_t depth)
+IndexedMerkleTree::IndexedMerkleTree(size_t depth, size_t tile_height)
     : depth_(depth)
+    , tile_height_(tile_height)
 {
     ASSERT(depth_ >= 1 && depth <= 32);
     total_size_ = 1UL << depth_;
-    hashes_.resize(total_size_ * 2 - 2);
 
-    // Exercise: Build the initial state of the entire tree.
+    leaves_.push_back({ 0, 0, 0 });
+    index_.insert(0, 0);
+
+    // Every node of a level starts out as the same hash, so each level costs a single compression and nothing needs to
+    // be stored until a leaf is written.
+    zero_hashes_.resize(depth_ + 1);
+    zero_hashes_[0] = leaves_[0].hash();
+    for (size_t i = 0; i < depth_; ++i) {
+        zero_hashes_[i + 1] = compress_pair(zero_hashes_[i], zero_hashes_[i]);
+    }
+    root_ = zero_hashes_[depth_];
+    hashes_ = NodeStore(std::vector<fr>(zero_hashes_.begin(), zero_hashes_.end() - 1), tile_height);
+}
+
+/**
+ * The value -> index map, rebuilt from the leaf values the first time it is needed after `open`. Callers that go on to
+ * use it from several threads fetch it once beforehand.
+ */
+const PredecessorIndex& IndexedMerkleTree::index() const
+{
+    if (!index_built_) {
+        const auto values = leaves_.values();
+        std::vector<std::pair<uint256_t, uint32_t>> entries(values.size());
+#ifndef NO_MULTITHREADING
+#pragma omp parallel for
+#endif
+        for (size_t i = 0; i < values.size(); ++i) {
+            entries[i] = { uint256_t(values[i]), static_cast<uint32_t>(i) };
+        }
+        index_.assign(std::move(entries));
+        index_built_ = true;
+    }
+    return index_;
 }
 
 /**
  * Fetches a hash-path from a given index in the tree.
  * Note that the size of the fr_hash_path vector should be equal to the depth of the tree.
  */
-fr_hash_path IndexedMerkleTree::get_hash_path(size_t)
+fr_hash_path IndexedMerkleTree::get_hash_path(size_t index) const
 {
-    // Exercise: fill the hash path for a given index.
     fr_hash_path path(depth_);
+    for (size_t i = 0; i < depth_; ++i) {
+        index &= ~1UL;
+        path[i] = std::make_pair(get_node(i, index), get_node(i, index + 1));
+        index >>= 1;
+    }
     return path;
 }
 
+/**
+ * The witness for the leaf with the largest value <= `value`. When `value` is not in the tree this is its low leaf,
+ * and the witness proves non-membership; when it is, `low_leaf.value == value` and the witness proves membership.
+ */
+low_leaf_witness IndexedMerkleTree::get_low_leaf_witness(fr const& value) const
+{
+    const size_t index = this->index().predecessor(uint256_t(value)).first;
+    return { leaves_[index], index, get_hash_path(index) };
+}
+
+/**
+ * `get_low_leaf_witness` for many values. Low leaves are found through the sorted index, the hash path of each distinct
+ * low leaf is built once however many values share it, and the lookups and paths are computed in parallel.
+ */
+std::vector<low_leaf_witness> IndexedMerkleTree::get_low_leaf_witnesses(std::span<const fr> values) const
+{
+    const auto& index = this->index();
+    std::vector<size_t> low_indices(values.size());
+#ifndef NO_MULTITHREADING
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < values.size(); ++i) {
+        low_indices[i] = index.predecessor(uint256_t(values[i])).first;
+    }
+
+    std::vector<size_t> distinct = low_indices;
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+    std::vector<fr_hash_path> paths(distinct.size());
+#ifndef NO_MULTITHREADING
+#pragma omp parallel for
+#endif
+    for (size_t j = 0; j < distinct.size(); ++j) {
+        paths[j] = get_hash_path(distinct[j]);
+    }
+
+    std::vector<low_leaf_witness> witnesses(values.size());
+#ifndef NO_MULTITHREADING
+#pragma omp parallel for
+#endif
+    for (size_t i = 0; i < values.size(); ++i) {
+        const size_t j = static_cast<size_t>(std::lower_bound(distinct.begin(), distinct.end(), low_indices[i]) -
+                                             distinct.begin());
+        witnesses[i] = { leaves_[low_indices[i]], low_indices[i], paths[j] };
+    }
+    return witnesses;
+}
+
 /**
  * Update the node values (i.e. `hashes_`) given the leaf hash `value` and its index `index`.
  * Note that indexing in the tree starts from 0.
  * This function should return the updated root of the tree.
  */
-fr IndexedMerkleTree::update_element_internal(size_t, fr const&)
+fr IndexedMerkleTree::update_element_internal(size_t index, fr const& value)
 {
-    // Exercise: insert the leaf hash `value` at `index`.
-    return 0;
+    fr current = value;
+    for (size_t i = 0; i < depth_; ++i) {
+        set_node(i, index, current);
+        const size_t left = index & ~1UL;
+        current = compress_pair(get_node(i, left), get_node(i, left + 1));
+        index >>= 1;
+    }
+    root_ = current;
+    return root_;
 }
 
 /**
- * Insert a new `value` in a new leaf in the `leaves_` vector in the form: {value, nextIdx, nextVal}
+ * Insert a new `value` in a new leaf in the `leaves_` store in the form: {value, nextIdx, nextVal}
  * You will need to compute `nextIdx, nextVal` according to the way indexed merkle trees work.
  * Further, you will need to update one old leaf pre-image on inserting a new leaf.
  * Lastly, insert the new leaf hash in the tree as well as update the existing leaf hash of the old leaf.
  */
-fr IndexedMerkleTree::update_element(fr const&)
+fr IndexedMerkleTree::update_element(fr const& value)
+{
+    const auto [low_index, exists] = index().predecessor(uint256_t(value));
+    if (exists) {
+        return root_;
+    }
+    ASSERT(leaves_.size() < total_size_);
+
+    // The new leaf takes over the low leaf's pointer, and the low leaf now points at the new leaf.
+    const size_t new_index = leaves_.size();
+    const leaf new_leaf = { value, leaves_[low_index].nextIndex, leaves_[low_index].nextValue };
+    set_next(low_index, new_index, value);
+
+    update_element_internal(low_index, leaves_[low_index].hash());
+    leaves_.push_back(new_leaf);
+    index_.insert(uint256_t(value), static_cast<uint32_t>(new_index));
+    return update_element_internal(new_index, new_leaf.hash());
+}
+
+/**
+ * Insert several values at once. Values already in the tree, and repeats within the batch, are skipped. The new leaves
+ * are written at consecutive indices in the order the values were given, so the resulting tree is identical to calling
+ * `update_element` on each value in turn, and the witnesses are those of that sequence of insertions.
+ *
+ * Sorting the batch lets each low leaf be resolved in one pass: the new values falling between two consecutive existing
+ * leaves form a chain hanging off the lower one. Within a chain, the low leaf of a value at the time it is inserted is
+ * the nearest smaller value inserted before it (or the existing leaf), and that low leaf's successor is the nearest
+ * larger one inserted before it (or the existing leaf's successor); both are found with a stack.
+ *
+ * Each insertion writes two leaves, so every node above them takes one value per insertion that changes it: the
+ * witness of an insertion opens against the root of the tree just before it. These node versions are hashed level by
+ * level, each level as one batch by `compress_pairs`: in parallel, and normalised with a single shared batch
+ * inversion. The result does not depend on the thread count. Only the final version of each node is written to
+ * `hashes_`.
+ */
+batch_update_result IndexedMerkleTree::update_elements(std::span<const fr> values)
+{
+    struct insertion {
+        uint256_t key;
+        fr value;
+        size_t index;
+    };
+
+    // Drop duplicates (keeping the first occurrence, which determines the leaf index) and existing values.
+    std::vector<insertion> sorted;
+    sorted.reserve(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+        sorted.push_back({ uint256_t(values[i]), values[i], i });
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](auto const& a, auto const& b) { return a.key < b.key; });
+    sorted.erase(std::unique(sorted.begin(), sorted.end(), [](auto const& a, auto const& b) { return a.key == b.key; }),
+                 sorted.end());
+    const auto& index = this->index();
+    std::erase_if(sorted, [&](auto const& ins) { return index.predecessor(ins.key).second; });
+
+    // Leaf indices follow input order, and so does the order of insertion: value `t` of the batch is inserted at time
+    // t, into leaf first_new_index + t.
+    std::vector<size_t> order(sorted.size());
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sorted[a].index < sorted[b].index; });
+    const size_t first_new_index = leaves_.size();
+    ASSERT(first_new_index + sorted.size() <= total_size_);
+    for (size_t i = 0; i < order.size(); ++i) {
+        sorted[order[i]].index = first_new_index + i;
+    }
+    const auto time_of = [&](size_t i) { return sorted[i].index - first_new_index; };
+
+    batch_update_result result;
+    result.low_leaf_witnesses.resize(sorted.size());
+    if (sorted.empty()) {
+        result.root = root_;
+        return result;
+    }
+
+    // The leaves each insertion writes, in level 0: the low leaf, now pointing at the new leaf, and the new leaf.
+    std::vector<node_version> leaf_versions;
+    std::vector<leaf> written;
+    leaf_versions.reserve(2 * sorted.size());
+    written.reserve(2 * sorted.size());
+    leaves_.resize(first_new_index + sorted.size());
+    std::vector<size_t> stack;
+
+    for (size_t begin = 0; begin < sorted.size();) {
+        const size_t low_index = index.predecessor(sorted[begin].key).first;
+        const leaf low_leaf = leaves_[low_index];
+
+        // The chain of new values between `low_leaf` and its current successor.
+        size_t end = begin + 1;
+        while (end < sorted.size() && index.predecessor(sorted[end].key).first == low_index) {
+            ++end;
+        }
+
+        // below[i] / above[i]: the nearest value of the chain under / over sorted[i] inserted before it, or `end` if
+        // there is none.
+        std::vector<size_t> below(end - begin);
+        std::vector<size_t> above(end - begin);
+        stack.clear();
+        for (size_t i = begin; i < end; ++i) {
+            while (!stack.empty() && time_of(stack.back()) > time_of(i)) {
+                stack.pop_back();
+            }
+            below[i - begin] = stack.empty() ? end : stack.back();
+            stack.push_back(i);
+        }
+        stack.clear();
+        for (size_t i = end; i-- > begin;) {
+            while (!stack.empty() && time_of(stack.back()) > time_of(i)) {
+                stack.pop_back();
+            }
+            above[i - begin] = stack.empty() ? end : stack.back();
+            stack.push_back(i);
+        }
+
+        for (size_t i = begin; i < end; ++i) {
+            const size_t lower = below[i - begin];
+            const size_t upper = above[i - begin];
+            const size_t witness_index = lower == end ? low_index : sorted[lower].index;
+            const leaf witness_leaf = { lower == end ? low_leaf.value : sorted[lower].value,
+                                        upper == end ? low_leaf.nextIndex : index_t(sorted[upper].index),
+                                        upper == end ? low_leaf.nextValue : sorted[upper].value };
+            result.low_leaf_witnesses[time_of(i)] = { witness_leaf, witness_index, {} };
+
+            leaf_versions.push_back({ witness_index, time_of(i), {} });
+            written.push_back({ witness_leaf.value, index_t(sorted[i].index), sorted[i].value });
+            leaf_versions.push_back({ sorted[i].index, time_of(i), {} });
+            written.push_back({ sorted[i].value, witness_leaf.nextIndex, witness_leaf.nextValue });
+
+            // The final state of the chain: sorted by value, between the low leaf and its old successor.
+            const bool last = i + 1 == end;
+            leaves_.set(sorted[i].index,
+                        { sorted[i].value,
+                          last ? low_leaf.nextIndex : index_t(sorted[i + 1].index),
+                          last ? low_leaf.nextValue : sorted[i + 1].value });
+        }
+        set_next(low_index, sorted[begin].index, sorted[begin].value);
+        begin = end;
+    }
+    for (auto const& ins : sorted) {
+        index_.insert(ins.key, static_cast<uint32_t>(ins.index));
+    }
+
+    const auto leaf_hashes = hash_leaves(written);
+    for (size_t i = 0; i < leaf_versions.size(); ++i) {
+        leaf_versions[i].value = leaf_hashes[i];
+    }
+    const auto versions = hash_versions(std::move(leaf_versions));
+
+#ifndef NO_MULTITHREADING
+#pragma omp parallel for
+#endif
+    for (size_t t = 0; t < sorted.size(); ++t) {
+        auto& witness = result.low_leaf_witnesses[t];
+        witness.path.resize(depth_);
+        size_t node = witness.index;
+        for (size_t i = 0; i < depth_; ++i) {
+            node &= ~1UL;
+            witness.path[i] = { node_before(versions[i], i, node, t), node_before(versions[i], i, node + 1, t) };
+            node >>= 1;
+        }
+    }
+
+    for (size_t i = 0; i < depth_; ++i) {
+        const auto& level = versions[i];
+        for (size_t j = 0; j < level.size(); ++j) {
+            if (j + 1 == level.size() || level[j + 1].index != level[j].index) {
+                set_node(i, level[j].index, level[j].value);
+            }
+        }
+    }
+    root_ = versions[depth_].back().value;
+    result.root = root_;
+    return result;
+}
+
+void IndexedMerkleTree::checkpoint()
+{
+    checkpoints_.push_back({ leaves_.size(), root_, leaf_undo_.size(), node_undo_.size() });
+}
+
+void IndexedMerkleTree::revert()
+{
+    ASSERT(!checkpoints_.empty());
+    const auto cp = checkpoints_.back();
+    checkpoints_.pop_back();
+
+    while (node_undo_.size() > cp.node_undo_size) {
+        const auto& undo = node_undo_.back();
+        hashes_.set(undo.level, undo.index, undo.value);
+        mark_node_dirty(undo.level, undo.index);
+        node_undo_.pop_back();
+    }
+    while (leaf_undo_.size() > cp.leaf_undo_size) {
+        leaves_.set(leaf_undo_.back().first, leaf_undo_.back().second);
+        mark_leaf_dirty(leaf_undo_.back().first);
+        leaf_undo_.pop_back();
+    }
+    if (index_built_) {
+        for (size_t i = cp.num_leaves; i < leaves_.size(); ++i) {
+            index_.erase(uint256_t(leaves_[i].value));
+        }
+    }
+    leaves_.resize(cp.num_leaves);
+    root_ = cp.root;
+    if (snapshots_ != nullptr) {
+        snapshots_->published_leaves = std::min(snapshots_->published_leaves, cp.num_leaves);
+    }
+}
+
+void IndexedMerkleTree::commit()
+{
+    ASSERT(!checkpoints_.empty());
+    checkpoints_.pop_back();
+    if (checkpoints_.empty()) {
+        leaf_undo_.clear();
+        node_undo_.clear();
+    }
+}
+
+void IndexedMerkleTree::set_node(size_t level, size_t index, fr const& value)
+{
+    if (!checkpoints_.empty()) {
+        node_undo_.push_back({ level, index, hashes_.get(level, index) });
+    }
+    hashes_.set(level, index, value);
+    mark_node_dirty(level, index);
+}
+
+// Leaves appended since the innermost checkpoint need no journal entry: reverting drops them.
+void IndexedMerkleTree::set_next(size_t index, index_t const& next_index, fr const& next_value)
+{
+    if (!checkpoints_.empty() && index < checkpoints_.back().num_leaves) {
+        leaf_undo_.emplace_back(index, leaves_[index]);
+    }
+    leaves_.set_next(index, next_index, next_value);
+    mark_leaf_dirty(index);
+}
+
+void IndexedMerkleTree::mark_node_dirty(size_t level, size_t index)
+{
+    if (snapshots_ != nullptr) {
+        const auto loc = hashes_.locate(level, index);
+        auto& dirty = snapshots_->dirty_tiles;
+        // Consecutive writes usually hit the same tile.
+        if (dirty.empty() || dirty.back() != std::make_pair(loc.band, loc.tile)) {
+            dirty.emplace_back(loc.band, loc.tile);
+        }
+    }
+}
+
+void IndexedMerkleTree::mark_leaf_dirty(size_t index)
+{
+    if (snapshots_ != nullptr) {
+        snapshots_->dirty_leaf_pages.push_back(index / TreeSnapshot::LEAF_PAGE_SIZE);
+    }
+}
+
+/**
+ * The versions of every node above `leaf_versions`, level by level up to the root (level `depth_`), each level
+ * sorted by index and then time. A node takes a new version at each time one of its children does, hashed from the
+ * latest versions of both children at that time.
+ */
+std::vector<std::vector<IndexedMerkleTree::node_version>> IndexedMerkleTree::hash_versions(
+    std::vector<node_version> leaf_versions) const
+{
+    const auto by_index_and_time = [](auto const& a, auto const& b) {
+        return a.index < b.index || (a.index == b.index && a.time < b.time);
+    };
+    std::vector<std::vector<node_version>> versions(depth_ + 1);
+    versions[0] = std::move(leaf_versions);
+    std::sort(versions[0].begin(), versions[0].end(), by_index_and_time);
+
+    std::vector<std::pair<fr, fr>> pairs;
+    for (size_t i = 0; i < depth_; ++i) {
+        auto& parents = versions[i + 1];
+        parents.reserve(versions[i].size());
+        for (auto const& child : versions[i]) {
+            parents.push_back({ child.index >> 1, child.time, {} });
+        }
+        std::sort(parents.begin(), parents.end(), by_index_and_time);
+        parents.erase(std::unique(parents.begin(),
+                                  parents.end(),
+                                  [](auto const& a, auto const& b) { return a.index == b.index && a.time == b.time; }),
+                      parents.end());
+        pairs.resize(parents.size());
+#ifndef NO_MULTITHREADING
+#pragma omp parallel for
+#endif
+        for (size_t j = 0; j < parents.size(); ++j) {
+            const size_t left = parents[j].index << 1;
+            pairs[j] = { node_before(versions[i], i, left, parents[j].time + 1),
+                         node_before(versions[i], i, left + 1, parents[j].time + 1) };
+        }
+        const auto hashes = compress_pairs(pairs);
+        for (size_t j = 0; j < parents.size(); ++j) {
+            parents[j].value = hashes[j];
+        }
+    }
+    return versions;
+}
+
+/**
+ * The value of node (`level`, `index`) before time `time`: its latest version in `level_versions` from an earlier
+ * time, or else its value in the tree.
+ */
+fr IndexedMerkleTree::node_before(std::vector<node_version> const& level_versions,
+                                  size_t level,
+                                  size_t index,
+                                  size_t time) const
 {
-    // Exercise: add a new leaf with value `value` to the tree.
-    return 0;
+    const auto it = std::lower_bound(
+        level_versions.begin(), level_versions.end(), std::make_pair(index, time), [](auto const& v, auto const& key) {
+            return v.index < key.first || (v.index == key.first && v.time < key.second);
+        });
+    if (it != level_versions.begin() && std::prev(it)->index == index) {
+        return std::prev(it)->value;
+    }
+    return get_node(level, index);
 }
 
 } // namespace indexed_merkle_tree
@@ -1,6 +1,13 @@
 #pragma once
 #include <stdlib/merkle_tree/hash_path.hpp>
 #include "leaf.hpp"
+#include "leaf_store.hpp"
+#include "node_store.hpp"
+#include "predecessor_index.hpp"
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
 
 namespace plonk {
 namespace stdlib {
@@ -9,23 +16,96 @@ namespace indexed_merkle_tree {
 using namespace barretenberg;
 using namespace plonk::stdlib::merkle_tree;
 
+/**
+ * A low leaf pre-image, its index and its hash path: what a circuit needs to check that a value lies strictly between
+ * `low_leaf.value` and `low_leaf.nextValue`, i.e. is not in the tree (or, for an insertion, may be inserted).
+ *
+ * The witnesses returned by `update_elements` are those of inserting its new values one at a time, in the order given:
+ * `low_leaf` is the pre-image of the low leaf just before the value is inserted, `index` its position and `path` its
+ * hash path against the root at that moment, after the batch's earlier insertions. The low leaf may itself be one of
+ * those. A circuit can thus check the insertions in turn, each against the root the one before it produced.
+ */
+struct low_leaf_witness {
+    leaf low_leaf;
+    size_t index;
+    fr_hash_path path;
+};
+
+struct batch_update_result {
+    // Root after the whole batch.
+    fr root;
+    // One witness per inserted value, in the order the new leaves were written.
+    std::vector<low_leaf_witness> low_leaf_witnesses;
+};
+
+/**
+ * An immutable view of an IndexedMerkleTree as of one `publish`, which any number of threads may query without locks
+ * while the tree goes on changing. Obtained from IndexedMerkleTree::snapshot().
+ *
+ * Nodes are held tile by tile (in the tree's NodeStore layout) and leaves page by page, each page behind a shared_ptr
+ * to const. Publishing copies only the tiles and pages written since the previous publish and shares the rest, along
+ * with the blocks of the predecessor index, so a page lives as long as the newest snapshot using it.
+ */
+class TreeSnapshot {
+  public:
+    static constexpr size_t LEAF_PAGE_SIZE = 128;
+
+    fr root() const { return root_; }
+
+    // Number of leaves.
+    size_t size() const { return num_leaves_; }
+
+    // Counts publishes, starting from 1.
+    uint64_t version() const { return version_; }
+
+    fr get_node(size_t level, size_t index) const;
+
+    fr_hash_path get_hash_path(size_t index) const;
+
+    leaf get_leaf(size_t index) const;
+
+    low_leaf_witness get_low_leaf_witness(fr const& value) const;
+
+  private:
+    friend class IndexedMerkleTree;
+
+    TreeSnapshot() = default;
+
+    size_t depth_;
+    fr root_;
+    size_t num_leaves_ = 0;
+    uint64_t version_ = 0;
+    // An empty NodeStore of the tree's shape: node locations, and the value of every node in no tile.
+    std::shared_ptr<const NodeStore> layout_;
+    // tiles_[band][tile]; null for a tile nothing has been written to
+    std::vector<std::vector<std::shared_ptr<const std::vector<fr>>>> tiles_;
+    std::vector<std::shared_ptr<const std::vector<leaf>>> leaf_pages_;
+    PredecessorIndex index_;
+};
+
 /**
  * An IndexedMerkleTree is structured just like a usual merkle tree:
  *
  *                                       hashes_
  *    +------------------------------------------------------------------------------+
  *    |  0 -> h_{0,0}  h_{0,1}  h_{0,2}  h_{0,3}  h_{0,4}  h_{0,5}  h_{0,6}  h_{0,7} |
- *  i |                                                                              |
- *  n |  8 -> h_{1,0}  h_{1,1}  h_{1,2}  h_{1,3}                                     |
- *  d |                                                                              |
- *  e | 12 -> h_{2,0}  h_{2,1}                                                       |
- *  x |                                                                              |
- *    | 14 -> h_{3,0}                                                                |
+ *  l |                                                                              |
+ *  e |  1 -> h_{1,0}  h_{1,1}  h_{1,2}  h_{1,3}                                     |
+ *  v |                                                                              |
+ *  e |  2 -> h_{2,0}  h_{2,1}                                                       |
+ *  l |                                                                              |
  *    +------------------------------------------------------------------------------+
+ *                                       root_ = h_{3,0}
+ *
+ * Here, depth_ = 3, {h_{0,j}}_{j=0..7} are the leaf hashes and total_size_ = 2^3 = 8 is the number of leaves.
+ * `hashes_` holds levels 0 to depth_ - 1, read with get_node(level, index), and the root is kept apart in root_.
+ * Lastly, h_{i,j} = hash( h_{i-1,2j}, h_{i-1,2j+1} ) where i >= 1.
  *
- * Here, depth_ = 3 and {h_{0,j}}_{i=0..7} are leaf values.
- * Also, root_ = h_{3,0} and total_size_ = (2 * 8 - 2) = 14.
- * Lastly, h_{i,j} = hash( h_{i-1,2j}, h_{i-1,2j+1} ) where i > 1.
+ * That is the logical layout. Physically, `hashes_` is a NodeStore, which stores the tree in tiles of `tile_height`
+ * levels so that a hash path touches a few contiguous tiles rather than `depth_` distant regions (see node_store.hpp).
+ * Leaves are only ever appended, so only the tiles covering the populated prefix of each level exist; every other node
+ * is the root of an empty subtree of height i, `zero_hashes_[i]`. A tree therefore needs O(depth) hashes to construct
+ * and O(number of leaves) memory, whatever its depth.
  *
  * 1. Initial state:
  *
@@ -66,39 +146,193 @@ using namespace plonk::stdlib::merkle_tree;
  *  val       0       30      10      20       50      0       0       0
  *  nextIdx   2       4       3       1        0       0       0       0
  *  nextVal   10      50      20      30       0       0       0       0
+ *
+ * The low leaf of a new value (the leaf with the largest value below it) is found through `index_`, an ordered
+ * map from leaf value to leaf index, so an insertion costs O(log n) comparisons rather than a scan over `leaves_`.
+ *
+ * A tree built by `open` lives in a directory instead of in memory: the leaf columns and node bands are memory-mapped
+ * files, and a small `header` file records the depth, tile height, leaf count, band sizes, root and empty-subtree
+ * hashes. Insertions only change private copies of the mapped pages until `persist`, which first writes the dirty
+ * pages and the new header to a `journal` and fsyncs it (the commit record), then writes the pages into place and swaps
+ * in the new header. Reopening replays a complete journal left by a crash, or drops a torn one, and otherwise just
+ * reads the header and maps the files: no leaf is re-hashed, and `index_` is rebuilt from the leaf values on first use.
+ * File-backed trees need mmap, and are not built for WASM.
+ *
+ * Changes can be made speculatively between `checkpoint` and `revert`/`commit`. While a checkpoint is open, every
+ * existing leaf pre-image or node hash about to be overwritten is first pushed on an undo journal (`leaf_undo_`,
+ * `node_undo_`), and each checkpoint remembers how long the journals and `leaves_` were when it was opened. Reverting
+ * pops the journals back to that point, restoring the old values in reverse order, and truncates `leaves_`; committing
+ * leaves the entries in place for an enclosing checkpoint, or drops them if there is none.
+ *
+ * After `enable_snapshots`, readers on other threads can take a TreeSnapshot of the last published state while the
+ * (single) writer carries on. Every tile and leaf page written is noted, and `publish` turns those into fresh
+ * immutable pages of a new snapshot, which readers pick up by copying one shared_ptr under a mutex.
  */
 class IndexedMerkleTree {
   public:
-    IndexedMerkleTree(size_t depth);
+    // Tiles of 6 levels hold 126 nodes: one 4 KiB page of fr.
+    static constexpr size_t DEFAULT_TILE_HEIGHT = 6;
+
+    IndexedMerkleTree(size_t depth, size_t tile_height = DEFAULT_TILE_HEIGHT);
+
+#ifndef __wasm__
+    /**
+     * Opens the file-backed tree in `directory`, or creates an empty one there with the given depth and tile height
+     * if the directory holds none. An existing tree keeps the tile height it was created with; its depth must match.
+     * Whatever was inserted after the last `persist` is gone.
+     */
+    static IndexedMerkleTree open(std::string const& directory, size_t depth, size_t tile_height = DEFAULT_TILE_HEIGHT);
+
+    /**
+     * Makes every insertion since the last `persist` durable. Does nothing for an in-memory tree.
+     */
+    void persist();
+#endif
+
+    fr_hash_path get_hash_path(size_t index) const;
+
+    low_leaf_witness get_low_leaf_witness(fr const& value) const;
+
+    std::vector<low_leaf_witness> get_low_leaf_witnesses(std::span<const fr> values) const;
+
+    /**
+     * Opens a checkpoint: every change from here on can be undone by `revert` or kept by `commit`. Checkpoints nest.
+     */
+    void checkpoint();
 
-    fr_hash_path get_hash_path(size_t index);
+    /**
+     * Undoes every change made since the innermost open checkpoint, and closes it. This costs as much as the changes
+     * being undone, with no hashing.
+     */
+    void revert();
+
+    /**
+     * Closes the innermost open checkpoint, keeping its changes. They can still be undone by reverting an enclosing
+     * checkpoint.
+     */
+    void commit();
+
+    /**
+     * Turns on snapshot reads and publishes the current state. The snapshot pages hold a second copy of the tree.
+     */
+    void enable_snapshots();
+
+    /**
+     * Makes the current state the one returned by `snapshot`. Called by the writer, typically once per batch; costs
+     * a copy of the pages written since the last publish, plus one pointer per page.
+     */
+    void publish();
+
+    /**
+     * The last published state. May be called from any thread, concurrently with the writer.
+     */
+    std::shared_ptr<const TreeSnapshot> snapshot() const;
 
     fr update_element_internal(size_t index, fr const& value);
 
     fr update_element(fr const& value);
 
+    batch_update_result update_elements(std::span<const fr> values);
+
     fr root() const { return root_; }
 
-    const std::vector<barretenberg::fr>& get_hashes() { return hashes_; }
-    const std::vector<leaf>& get_leaves() { return leaves_; }
+    fr get_node(size_t level, size_t index) const { return hashes_.get(level, index); }
+
+    /**
+     * The hash of leaf `index`, as stored in the bottom level of the tree: always equal to `get_leaves()[index].hash()`
+     * (or to the empty leaf's hash past the last leaf), without recomputing it.
+     */
+    fr get_leaf_hash(size_t index) const { return get_node(0, index); }
+
+    const LeafStore& get_leaves() { return leaves_; }
 
   private:
+    IndexedMerkleTree() = default;
+
+    const PredecessorIndex& index() const;
+
+    // Writes through these record the overwritten value while a checkpoint is open.
+    void set_node(size_t level, size_t index, fr const& value);
+    void set_next(size_t index, index_t const& next_index, fr const& next_value);
+
+    // Note a write for the next `publish`, if snapshots are enabled.
+    void mark_node_dirty(size_t level, size_t index);
+    void mark_leaf_dirty(size_t index);
+
+    // The value node (level, index) takes at one insertion of an `update_elements` batch, the level being implied.
+    struct node_version {
+        size_t index;
+        size_t time;
+        fr value;
+    };
+
+    std::vector<std::vector<node_version>> hash_versions(std::vector<node_version> leaf_versions) const;
+    fr node_before(std::vector<node_version> const& level_versions, size_t level, size_t index, size_t time) const;
+
     // The depth or height of the tree
     size_t depth_;
 
+    size_t tile_height_;
+
     // The total number of leaves in the tree
     size_t total_size_;
 
     // The root of the merkle tree
     barretenberg::fr root_;
 
-    // Vector of pre-images of leaf values of the form {val, nextIdx, nextIdx}
-    // Size = total_size_
-    std::vector<leaf> leaves_;
+    // Pre-images of the populated leaves, of the form {val, nextIdx, nextVal}, stored column by column
+    // Size = number of inserted values + 1
+    LeafStore leaves_;
+
+    // The populated part of every level of the tree below the root, leaf hashes in level 0
+    NodeStore hashes_;
+
+    // zero_hashes_[i] is the root of an empty subtree of height i (zero_hashes_[0] = H({0, 0, 0}))
+    // Size = depth_ + 1
+    std::vector<barretenberg::fr> zero_hashes_;
+
+    // Leaf values (as canonical integers) -> leaf indices, kept in step with `leaves_` once built. Read it through
+    // `index()`, which rebuilds it first if need be.
+    mutable PredecessorIndex index_;
+    mutable bool index_built_ = true;
+
+    struct checkpoint_state {
+        size_t num_leaves;
+        fr root;
+        size_t leaf_undo_size;
+        size_t node_undo_size;
+    };
+
+    struct node_undo {
+        size_t level;
+        size_t index;
+        fr value;
+    };
+
+    // Open checkpoints, innermost last, and the undo journal shared by them: old pre-images of existing leaves, and old
+    // node hashes, oldest first
+    std::vector<checkpoint_state> checkpoints_;
+    std::vector<std::pair<size_t, leaf>> leaf_undo_;
+    std::vector<node_undo> node_undo_;
+
+    struct snapshot_state {
+        // Held only to copy or replace `latest`: readers never wait on a publish
+        std::mutex latest_mutex;
+        std::shared_ptr<const TreeSnapshot> latest;
+        std::shared_ptr<const NodeStore> layout;
+        // (band, tile) pairs and leaf pages written since the last publish, with repeats
+        std::vector<std::pair<size_t, size_t>> dirty_tiles;
+        std::vector<size_t> dirty_leaf_pages;
+        // Leaves from here on are (re)copied by the next publish
+        size_t published_leaves = 0;
+    };
+
+    // Null until `enable_snapshots`
+    std::unique_ptr<snapshot_state> snapshots_;
 
-    // Vector that stores all the leaf hashes as well as intermediate node values
-    // Size: total_size_ + (total_size_ / 2) + (total_size_ / 4) + ... + 2 = 2 * total_size_ - 2
-    std::vector<barretenberg::fr> hashes_;
+    // Where a file-backed tree lives (empty for an in-memory tree), and the number of times it was persisted
+    std::string directory_;
+    uint64_t sequence_ = 0;
 };
 
 } // namespace indexed_merkle_tree
@@ -1,6 +1,14 @@
 #include "indexed_merkle_tree.hpp"
 #include <gtest/gtest.h>
+#ifndef __wasm__
+#include <filesystem>
+#include <fstream>
+#endif
+#ifndef NO_MULTITHREADING
+#include <omp.h>
+#endif
 #include <stdlib/types/turbo.hpp>
+#include <thread>
 
 using namespace barretenberg;
 using namespace plonk::stdlib::indexed_merkle_tree;
@@ -201,4 +209,425 @@ TEST(stdlib_indexed_merkle_tree, test_real_example)
     // Merkle proof at `index` proves non-membership of `new_member`
     auto hash_path = tree.get_hash_path(index);
     EXPECT_TRUE(check_hash_path(tree.root(), hash_path, leaves[index], index));
-}
\ No newline at end of file
+}
+
+TEST(stdlib_indexed_merkle_tree, test_sorted_linked_list)
+{
+    // Enough values to split the blocks of the predecessor index several times.
+    constexpr size_t depth = 11;
+    constexpr size_t num_values = 2000;
+    IndexedMerkleTree tree(depth);
+
+    std::vector<uint256_t> inserted = { 0 };
+    for (size_t i = 0; i < num_values; i++) {
+        auto value = fr::random_element();
+        tree.update_element(value);
+        inserted.push_back(uint256_t(value));
+    }
+    // Re-inserting existing values must be a no-op.
+    auto root = tree.root();
+    tree.update_element(fr(inserted[num_values / 2]));
+    EXPECT_EQ(tree.root(), root);
+
+    // Following nextIndex from the zero leaf must visit every value in ascending order.
+    std::sort(inserted.begin(), inserted.end());
+    const auto& leaves = tree.get_leaves();
+    EXPECT_EQ(leaves.size(), num_values + 1);
+    size_t current = 0;
+    for (size_t i = 0; i < inserted.size(); i++) {
+        EXPECT_EQ(uint256_t(leaves[current].value), inserted[i]);
+        current = static_cast<size_t>(leaves[current].nextIndex);
+    }
+    EXPECT_EQ(current, 0UL);
+
+    for (size_t i = 0; i < leaves.size(); i += 97) {
+        EXPECT_TRUE(check_hash_path(tree.root(), tree.get_hash_path(i), leaves[i], i));
+    }
+}
+
+TEST(stdlib_indexed_merkle_tree, test_batch_insertion)
+{
+    constexpr size_t depth = 8;
+    IndexedMerkleTree sequential(depth);
+    IndexedMerkleTree batched(depth);
+
+    std::vector<fr> first_batch = { 30, 10, 20 };
+    std::vector<fr> second_batch;
+    for (size_t i = 0; i < 60; i++) {
+        second_batch.push_back(fr::random_element());
+    }
+    // Values between and around existing leaves, an existing value and a repeat within the batch.
+    second_batch.push_back(15);
+    second_batch.push_back(12);
+    second_batch.push_back(20);
+    second_batch.push_back(12);
+    second_batch.push_back(50);
+
+    batched.update_elements(first_batch);
+    auto result = batched.update_elements(second_batch);
+    for (auto const& value : first_batch) {
+        sequential.update_element(value);
+    }
+    // The witness of each insertion is the one `sequential` gives just before it, against the root at that moment.
+    std::vector<low_leaf_witness> expected;
+    std::vector<fr> roots;
+    for (auto const& value : second_batch) {
+        const auto witness = sequential.get_low_leaf_witness(value);
+        const fr root = sequential.root();
+        if (sequential.update_element(value) != root) {
+            expected.push_back(witness);
+            roots.push_back(root);
+        }
+    }
+
+    EXPECT_EQ(result.root, sequential.root());
+    EXPECT_EQ(batched.root(), sequential.root());
+    EXPECT_EQ(batched.get_leaves(), sequential.get_leaves());
+    EXPECT_EQ(batched.get_hash_path(37), sequential.get_hash_path(37));
+    ASSERT_EQ(result.low_leaf_witnesses.size(), second_batch.size() - 2);
+    ASSERT_EQ(expected.size(), result.low_leaf_witnesses.size());
+
+    const auto& leaves = batched.get_leaves();
+    for (size_t i = 0; i < result.low_leaf_witnesses.size(); i++) {
+        const auto& witness = result.low_leaf_witnesses[i];
+        const auto value = uint256_t(leaves[4 + i].value);
+        EXPECT_TRUE(uint256_t(witness.low_leaf.value) < value);
+        EXPECT_TRUE(witness.low_leaf.nextValue == 0 || value < uint256_t(witness.low_leaf.nextValue));
+        EXPECT_EQ(witness.low_leaf, expected[i].low_leaf);
+        EXPECT_EQ(witness.index, expected[i].index);
+        EXPECT_EQ(witness.path, expected[i].path);
+        EXPECT_TRUE(check_hash_path(roots[i], witness.path, witness.low_leaf, witness.index));
+    }
+    // 15 is inserted before 12, and both hang off leaf 10: 15 opens it as it was, and 12 as it is after 15.
+    EXPECT_EQ(result.low_leaf_witnesses[60].low_leaf, leaf({ 10, 3, 20 }));
+    EXPECT_EQ(result.low_leaf_witnesses[61].low_leaf, leaf({ 10, 64, 15 }));
+    EXPECT_EQ(result.low_leaf_witnesses[61].index, 2UL);
+}
+
+TEST(stdlib_indexed_merkle_tree, test_depth_32)
+{
+    // Only the populated prefix of each level is stored, so a production-depth tree is cheap to create.
+    constexpr size_t depth = 32;
+    IndexedMerkleTree tree(depth);
+
+    std::vector<fr> zero_hashes = { leaf({ 0, 0, 0 }).hash() };
+    for (size_t i = 0; i < depth; i++) {
+        zero_hashes.push_back(compress_pair(zero_hashes[i], zero_hashes[i]));
+    }
+    EXPECT_EQ(tree.root(), zero_hashes[depth]);
+
+    std::vector<fr> values;
+    for (size_t i = 0; i < 100; i++) {
+        values.push_back(fr::random_element());
+    }
+    tree.update_elements(values);
+    tree.update_element(fr::random_element());
+
+    const auto& leaves = tree.get_leaves();
+    for (size_t i = 0; i < leaves.size(); i += 10) {
+        EXPECT_TRUE(check_hash_path(tree.root(), tree.get_hash_path(i), leaves[i], i));
+    }
+    // An empty leaf far to the right opens against the same root.
+    const size_t far_index = (1UL << depth) - 1;
+    EXPECT_TRUE(check_hash_path(tree.root(), tree.get_hash_path(far_index), leaf({ 0, 0, 0 }), far_index));
+    EXPECT_EQ(tree.get_node(depth - 1, 1), zero_hashes[depth - 1]);
+}
+
+TEST(stdlib_indexed_merkle_tree, test_large_batch_matches_sequential)
+{
+    // Large enough for every level below the top few to be hashed in parallel.
+    constexpr size_t depth = 12;
+    IndexedMerkleTree sequential(depth);
+    IndexedMerkleTree batched(depth);
+
+    std::vector<fr> values;
+    for (size_t i = 0; i < 1500; i++) {
+        values.push_back(fr::random_element());
+        sequential.update_element(values.back());
+    }
+    batched.update_elements(std::span<const fr>(values).first(700));
+    batched.update_elements(std::span<const fr>(values).subspan(700));
+
+    EXPECT_EQ(batched.root(), sequential.root());
+    for (size_t i = 0; i < depth; i++) {
+        EXPECT_EQ(batched.get_node(i, 5), sequential.get_node(i, 5));
+    }
+
+#ifndef NO_MULTITHREADING
+    // The same batches on one thread give the same tree.
+    const int num_threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+    IndexedMerkleTree single_threaded(depth);
+    single_threaded.update_elements(std::span<const fr>(values).first(700));
+    single_threaded.update_elements(std::span<const fr>(values).subspan(700));
+    omp_set_num_threads(num_threads);
+    EXPECT_EQ(single_threaded.root(), batched.root());
+#endif
+}
+
+TEST(stdlib_indexed_merkle_tree, test_batched_hashes)
+{
+    std::vector<std::pair<fr, fr>> pairs = { { 0, 0 }, { 1, 2 }, { 2, 1 } };
+    std::vector<leaf> leaves = { { 0, 0, 0 }, { 10, 3, 20 } };
+    for (size_t i = 0; i < 50; i++) {
+        pairs.emplace_back(fr::random_element(), fr::random_element());
+        leaves.push_back({ fr::random_element(), i, fr::random_element() });
+    }
+
+    const auto compressed = compress_pairs(pairs);
+    for (size_t i = 0; i < pairs.size(); i++) {
+        EXPECT_EQ(compressed[i], compress_pair(pairs[i].first, pairs[i].second));
+    }
+    const auto hashed = hash_leaves(leaves);
+    for (size_t i = 0; i < leaves.size(); i++) {
+        EXPECT_EQ(hashed[i], leaves[i].hash());
+    }
+}
+
+TEST(stdlib_indexed_merkle_tree, test_leaf_store_serialization)
+{
+    IndexedMerkleTree tree(6);
+    for (size_t i = 0; i < 40; i++) {
+        tree.update_element(fr::random_element());
+    }
+
+    // The store serialises leaf by leaf in the `leaf` format.
+    std::vector<uint8_t> buf;
+    tree.get_leaves().write(buf);
+    const uint8_t* it = &buf[4];
+    for (size_t i = 0; i < tree.get_leaves().size(); i++) {
+        leaf l;
+        l.read(it);
+        EXPECT_EQ(l, tree.get_leaves()[i]);
+    }
+
+    LeafStore restored;
+    it = &buf[0];
+    restored.read(it);
+    EXPECT_EQ(restored, tree.get_leaves());
+    EXPECT_EQ(restored.values()[7], tree.get_leaves()[7].value);
+}
+
+TEST(stdlib_indexed_merkle_tree, test_leaf_hashes)
+{
+    constexpr size_t depth = 5;
+    IndexedMerkleTree tree(depth);
+    std::vector<fr> values = { 30, 10, 20 };
+    tree.update_elements(values);
+    tree.update_element(50);
+
+    const auto& leaves = tree.get_leaves();
+    for (size_t i = 0; i < (1UL << depth); i++) {
+        const leaf expected = i < leaves.size() ? leaves[i] : leaf({ 0, 0, 0 });
+        EXPECT_EQ(tree.get_leaf_hash(i), expected.hash());
+    }
+    EXPECT_EQ(tree.get_hash_path(2)[0], std::make_pair(tree.get_leaf_hash(2), tree.get_leaf_hash(3)));
+}
+
+TEST(stdlib_indexed_merkle_tree, test_low_leaf_witnesses)
+{
+    constexpr size_t depth = 8;
+    IndexedMerkleTree tree(depth);
+    std::vector<fr> values = { 30, 10, 20, 50 };
+    tree.update_elements(values);
+
+    // 25 falls between 20 and 30, 60 is beyond the largest value, 20 is a member.
+    auto witness = tree.get_low_leaf_witness(25);
+    EXPECT_EQ(witness.low_leaf, leaf({ 20, 1, 30 }));
+    EXPECT_EQ(witness.index, 3UL);
+    EXPECT_TRUE(check_hash_path(tree.root(), witness.path, witness.low_leaf, witness.index));
+    EXPECT_EQ(tree.get_low_leaf_witness(60).low_leaf, leaf({ 50, 0, 0 }));
+    EXPECT_EQ(tree.get_low_leaf_witness(20).low_leaf.value, fr(20));
+
+    std::vector<fr> queries = { 25, 60, 5, 27, 11 };
+    for (size_t i = 0; i < 100; i++) {
+        queries.push_back(fr::random_element());
+    }
+    const auto witnesses = tree.get_low_leaf_witnesses(queries);
+    ASSERT_EQ(witnesses.size(), queries.size());
+    for (size_t i = 0; i < queries.size(); i++) {
+        const auto expected = tree.get_low_leaf_witness(queries[i]);
+        EXPECT_EQ(witnesses[i].low_leaf, expected.low_leaf);
+        EXPECT_EQ(witnesses[i].index, expected.index);
+        EXPECT_EQ(witnesses[i].path, expected.path);
+    }
+}
+
+TEST(stdlib_indexed_merkle_tree, test_tile_heights)
+{
+    // The tiled node layout is invisible to callers: every tile height gives the same tree.
+    constexpr size_t depth = 20;
+    std::vector<fr> values;
+    for (size_t i = 0; i < 300; i++) {
+        values.push_back(fr::random_element());
+    }
+
+    IndexedMerkleTree reference(depth, 1);
+    reference.update_elements(values);
+    reference.update_element(fr::random_element());
+    for (size_t tile_height : { 2UL, 3UL, 6UL, 7UL, 20UL }) {
+        IndexedMerkleTree tree(depth, tile_height);
+        tree.update_elements(values);
+        tree.update_element(reference.get_leaves()[301].value);
+
+        EXPECT_EQ(tree.root(), reference.root());
+        for (size_t index : { 0UL, 1UL, 63UL, 64UL, 200UL, 301UL, 302UL, (1UL << depth) - 1 }) {
+            EXPECT_EQ(tree.get_hash_path(index), reference.get_hash_path(index));
+        }
+    }
+}
+
+#ifndef __wasm__
+TEST(stdlib_indexed_merkle_tree, test_persistence)
+{
+    // A file-backed tree comes back from disk as it was when it was last persisted. The directory is the test's own,
+    // cleared of anything a crashed run left behind.
+    constexpr size_t depth = 20;
+    const auto* test = ::testing::UnitTest::GetInstance()->current_test_info();
+    const std::string directory = ::testing::TempDir() + "/" + test->test_suite_name() + "_" + test->name();
+    std::filesystem::remove_all(directory);
+
+    std::vector<fr> values;
+    for (size_t i = 0; i < 300; i++) {
+        values.push_back(fr::random_element());
+    }
+    IndexedMerkleTree reference(depth);
+    reference.update_elements(values);
+    {
+        auto tree = IndexedMerkleTree::open(directory, depth, 3);
+        tree.update_elements(values);
+        tree.persist();
+        tree.update_element(fr::random_element());
+    }
+
+    // A journal torn by a crash before its commit record was complete is ignored.
+    std::ofstream(directory + "/journal") << "torn";
+
+    auto tree = IndexedMerkleTree::open(directory, depth);
+    EXPECT_FALSE(std::filesystem::exists(directory + "/journal"));
+    EXPECT_EQ(tree.root(), reference.root());
+    EXPECT_EQ(tree.get_leaves(), reference.get_leaves());
+    for (size_t index : { 0UL, 1UL, 7UL, 8UL, 150UL, 300UL, 301UL, (1UL << depth) - 1 }) {
+        EXPECT_EQ(tree.get_hash_path(index), reference.get_hash_path(index));
+    }
+
+    const fr value = fr::random_element();
+    EXPECT_EQ(tree.update_element(value), reference.update_element(value));
+    EXPECT_EQ(tree.get_low_leaf_witness(values[7]).index, reference.get_low_leaf_witness(values[7]).index);
+    tree.persist();
+    EXPECT_EQ(IndexedMerkleTree::open(directory, depth).root(), reference.root());
+
+    std::filesystem::remove_all(directory);
+}
+#endif
+
+TEST(stdlib_indexed_merkle_tree, test_checkpoint_revert)
+{
+    constexpr size_t depth = 16;
+    std::vector<fr> values;
+    for (size_t i = 0; i < 300; i++) {
+        values.push_back(fr::random_element());
+    }
+    const std::span<const fr> first(values.data(), 100);
+    const std::span<const fr> second(values.data() + 100, 100);
+
+    IndexedMerkleTree tree(depth);
+    tree.update_elements(first);
+    const auto root0 = tree.root();
+    const LeafStore leaves0 = tree.get_leaves();
+
+    tree.checkpoint();
+    tree.update_elements(second);
+    const auto root1 = tree.root();
+    const LeafStore leaves1 = tree.get_leaves();
+
+    // A reverted inner checkpoint leaves the outer one's changes alone.
+    tree.checkpoint();
+    tree.update_element(values[200]);
+    tree.update_element(values[201]);
+    tree.revert();
+    EXPECT_EQ(tree.root(), root1);
+    EXPECT_EQ(tree.get_leaves(), leaves1);
+
+    // A committed inner checkpoint is undone along with the outer one.
+    tree.checkpoint();
+    tree.update_elements(std::span<const fr>(values.data() + 200, 100));
+    tree.commit();
+    tree.revert();
+    EXPECT_EQ(tree.root(), root0);
+    EXPECT_EQ(tree.get_leaves(), leaves0);
+
+    IndexedMerkleTree reference(depth);
+    reference.update_elements(first);
+    for (size_t index : { 0UL, 1UL, 50UL, 99UL, 100UL, 101UL, 250UL }) {
+        EXPECT_EQ(tree.get_hash_path(index), reference.get_hash_path(index));
+    }
+
+    // The reverted values are gone from the index too, so inserting them again gives the same tree as it would have.
+    tree.update_elements(second);
+    reference.update_elements(second);
+    EXPECT_EQ(tree.root(), reference.root());
+    EXPECT_EQ(tree.get_leaves(), reference.get_leaves());
+}
+
+TEST(stdlib_indexed_merkle_tree, test_snapshots)
+{
+    constexpr size_t depth = 16;
+    IndexedMerkleTree tree(depth);
+    std::vector<fr> values;
+    for (size_t i = 0; i < 100; i++) {
+        values.push_back(fr::random_element());
+    }
+    tree.update_elements(values);
+    tree.enable_snapshots();
+    const auto first = tree.snapshot();
+    const auto first_root = tree.root();
+    const auto first_path = tree.get_hash_path(42);
+
+    // Readers check the snapshots they take against their own root while the writer inserts and publishes.
+    std::atomic<bool> done = false;
+    std::atomic<size_t> failures = 0;
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < 4; r++) {
+        readers.emplace_back([&, r] {
+            size_t i = r;
+            while (!done) {
+                const auto snapshot = tree.snapshot();
+                const size_t index = (i++ * 7919) % snapshot->size();
+                const auto leaf = snapshot->get_leaf(index);
+                if (!check_hash_path(snapshot->root(), snapshot->get_hash_path(index), leaf, index) ||
+                    snapshot->get_low_leaf_witness(leaf.value).index != index) {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (size_t batch = 0; batch < 10; batch++) {
+        std::vector<fr> more;
+        for (size_t i = 0; i < 50; i++) {
+            more.push_back(fr::random_element());
+        }
+        tree.update_elements(more);
+        tree.checkpoint();
+        tree.update_element(fr::random_element());
+        tree.revert();
+        tree.publish();
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(failures, 0UL);
+
+    // Old snapshots are unaffected by later writes.
+    EXPECT_EQ(first->root(), first_root);
+    EXPECT_EQ(first->size(), 101UL);
+    EXPECT_EQ(first->get_hash_path(42), first_path);
+
+    const auto last = tree.snapshot();
+    EXPECT_EQ(last->version(), 11UL);
+    EXPECT_EQ(last->root(), tree.root());
+    for (size_t index : { 0UL, 1UL, 100UL, 300UL, 600UL, 601UL }) {
+        EXPECT_EQ(last->get_hash_path(index), tree.get_hash_path(index));
+    }
+}
@@ -1,6 +1,9 @@
 #pragma once
 #include <stdlib/primitives/field/field.hpp>
 #include <crypto/pedersen/pedersen.hpp>
+#include <span>
+#include <utility>
+#include <vector>
 
 namespace plonk {
 namespace stdlib {
@@ -46,6 +49,72 @@ inline barretenberg::fr compress_pair(barretenberg::fr const& lhs, barretenberg:
     return crypto::pedersen::compress_native({ lhs, rhs });
 }
 
+namespace detail {
+
+/**
+ * The x-coordinates of `num_hashes` Pedersen commitments of `width` inputs each, input k of commitment j being
+ * `input(j, k)`. Bit-identical to calling `compress_native` on each.
+ *
+ * `compress_native` accumulates the per-input points in projective form and then pays a field inversion to normalise
+ * the sum. Here the sums are accumulated the same way (in parallel) but all normalised together with
+ * `batch_normalize`, whose Montgomery batch inversion costs one inversion plus three multiplications per point.
+ */
+template <typename Input>
+std::vector<barretenberg::fr> batch_compress(size_t num_hashes, size_t width, Input const& input)
+{
+    using crypto::pedersen::generator_index_t;
+    std::vector<grumpkin::g1::element> sums(num_hashes);
+    auto accumulate = [&](size_t j) {
+        grumpkin::g1::element sum = crypto::pedersen::hash_single(input(j, 0), generator_index_t{ 0, 0 });
+        for (size_t k = 1; k < width; ++k) {
+            sum = crypto::pedersen::hash_single(input(j, k), generator_index_t{ 0, k }) + sum;
+        }
+        sums[j] = sum;
+    };
+
+    if (num_hashes == 0) {
+        return {};
+    }
+    // The generator tables are built lazily on first use, so build them before going wide.
+    accumulate(0);
+#ifndef NO_MULTITHREADING
+#pragma omp parallel for
+#endif
+    for (size_t j = 1; j < num_hashes; ++j) {
+        accumulate(j);
+    }
+
+    grumpkin::g1::element::batch_normalize(&sums[0], num_hashes);
+    std::vector<barretenberg::fr> result(num_hashes);
+    for (size_t j = 0; j < num_hashes; ++j) {
+        // compress_native maps the point at infinity to (0, 0).
+        result[j] = sums[j].is_point_at_infinity() ? barretenberg::fr(0) : sums[j].x;
+    }
+    return result;
+}
+
+} // namespace detail
+
+/**
+ * compress_pair over a whole batch of pairs, sharing one batch inversion.
+ */
+inline std::vector<barretenberg::fr> compress_pairs(
+    std::span<const std::pair<barretenberg::fr, barretenberg::fr>> pairs)
+{
+    return detail::batch_compress(
+        pairs.size(), 2, [&](size_t j, size_t k) { return k == 0 ? pairs[j].first : pairs[j].second; });
+}
+
+/**
+ * leaf::hash over a whole batch of leaves, sharing one batch inversion.
+ */
+inline std::vector<barretenberg::fr> hash_leaves(std::span<const leaf> leaves)
+{
+    return detail::batch_compress(leaves.size(), 3, [&](size_t j, size_t k) {
+        return k == 0 ? leaves[j].value : k == 1 ? barretenberg::fr(leaves[j].nextIndex) : leaves[j].nextValue;
+    });
+}
+
 } // namespace indexed_merkle_tree
 } // namespace stdlib
 } // namespace plonk
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+#include "column.hpp"
+#include "leaf.hpp"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace plonk {
+namespace stdlib {
+namespace indexed_merkle_tree {
+
+/**
+ * The leaves of an IndexedMerkleTree, stored as a structure of arrays:
+ *
+ *   values_        fr        32 bytes
+ *   next_indices_  uint32_t   4 bytes   (a leaf index never exceeds 2^32 - 1)
+ *   next_values_   fr        32 bytes
+ *
+ * That is 68 bytes a leaf instead of the 96 of a `leaf`, whose `nextIndex` is a uint256_t, and a scan over the values
+ * touches nothing else. A `leaf` is only assembled at the boundary, by `operator[]` (for hashing and callers) and by
+ * the serializers, which keep the `leaf` wire format.
+ *
+ * Each column is a Column, so a store is either in memory or, through `map`, in three files of a directory.
+ */
+class LeafStore {
+  public:
+    LeafStore() = default;
+
+#ifndef __wasm__
+    /**
+     * A store over the column files in `directory`, with room for `capacity` leaves, of which the first `size` are
+     * live.
+     */
+    static LeafStore map(std::string const& directory, size_t capacity, size_t size)
+    {
+        LeafStore store;
+        store.values_ = Column<fr>::map(directory + "/values", capacity, size);
+        store.next_indices_ = Column<uint32_t>::map(directory + "/next_indices", capacity, size);
+        store.next_values_ = Column<fr>::map(directory + "/next_values", capacity, size);
+        return store;
+    }
+#endif
+
+    size_t size() const { return values_.size(); }
+
+    leaf operator[](size_t index) const
+    {
+        return { values_[index], next_indices_[index], next_values_[index] };
+    }
+
+    std::span<const fr> values() const { return values_; }
+
+    void push_back(leaf const& l)
+    {
+        resize(size() + 1);
+        set(size() - 1, l);
+    }
+
+    // New leaves are {0, 0, 0}.
+    void resize(size_t size)
+    {
+        values_.resize(size, fr(0));
+        next_indices_.resize(size, 0U);
+        next_values_.resize(size, fr(0));
+    }
+
+    void set(size_t index, leaf const& l)
+    {
+        values_.set(index, l.value);
+        set_next(index, l.nextIndex, l.nextValue);
+    }
+
+    void set_next(size_t index, index_t const& next_index, fr const& next_value)
+    {
+        ASSERT(next_index < (uint256_t(1) << 32));
+        next_indices_.set(index, static_cast<uint32_t>(next_index));
+        next_values_.set(index, next_value);
+    }
+
+    bool operator==(LeafStore const&) const = default;
+
+    /**
+     * Serialises as a uint32 leaf count followed by each leaf in `leaf::write` format.
+     */
+    void write(std::vector<uint8_t>& buf) const
+    {
+        using serialize::write;
+        write(buf, static_cast<uint32_t>(size()));
+        for (size_t i = 0; i < size(); ++i) {
+            (*this)[i].write(buf);
+        }
+    }
+
+    void read(uint8_t const*& it)
+    {
+        using serialize::read;
+        uint32_t count = 0;
+        read(it, count);
+        resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            leaf l;
+            l.read(it);
+            set(i, l);
+        }
+    }
+
+    // Calls f(column) for each column, for IndexedMerkleTree::persist.
+    template <typename F> void for_each_column(F&& f)
+    {
+        f(values_);
+        f(next_indices_);
+        f(next_values_);
+    }
+
+  private:
+    Column<fr> values_;
+    Column<uint32_t> next_indices_;
+    Column<fr> next_values_;
+};
+
+} // namespace indexed_merkle_tree
+} // namespace stdlib
+} // namespace plonk
@@ -0,0 +1,179 @@
+#pragma once
+#include "column.hpp"
+#include <stdlib/primitives/field/field.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace plonk {
+namespace stdlib {
+namespace indexed_merkle_tree {
+
+using namespace barretenberg;
+
+/**
+ * The internal nodes (and leaf hashes) of an IndexedMerkleTree, addressed by (level, index) with level 0 the leaves.
+ *
+ * Levels are grouped into bands of `tile_height` levels, and each band is cut into tiles: the subtree of height
+ * `tile_height` hanging below one sibling pair at the top of the band. A tile is stored contiguously, bottom level
+ * first, so a hash path (or an update walking up it) touches one tile per band instead of one far-apart region per
+ * level. With tile_height = 6 a tile holds 2^7 - 2 = 126 nodes, which fits in one 4 KiB page; tile_height = 1 is the
+ * plain level-by-level layout.
+ *
+ * For tile_height = 2 and depth = 4:
+ *
+ *    band 1:  | h_{2,0} h_{2,1} h_{2,2} h_{2,3} h_{3,0} h_{3,1} |
+ *    band 0:  | h_{0,0} .. h_{0,3} h_{1,0} h_{1,1} | h_{0,4} .. h_{0,7} h_{1,2} h_{1,3} | ...
+ *
+ * (The top band is shorter when tile_height does not divide the depth.) Tiles are only materialised once something in
+ * them is written; reads of anything else return the level's empty-subtree hash, and a new tile starts out filled with
+ * those.
+ *
+ * Each band's tiles are one Column, so the store is either in memory or, through `map`, in one file per band.
+ */
+class NodeStore {
+  public:
+    NodeStore() = default;
+
+    /**
+     * @param zero_hashes zero_hashes[level] is the value of every node of `level` that has not been written; one entry
+     * per stored level (the tree depth).
+     */
+    NodeStore(std::vector<fr> const& zero_hashes, size_t tile_height)
+        : zero_hashes_(zero_hashes)
+    {
+        const size_t depth = zero_hashes.size();
+        ASSERT(tile_height >= 1);
+        for (size_t bottom = 0; bottom < depth; bottom += tile_height) {
+            const size_t height = std::min(tile_height, depth - bottom);
+            band b;
+            b.stride = (1UL << (height + 1)) - 2;
+            b.max_tiles = 1UL << (depth - bottom - height);
+            b.empty_tile.reserve(b.stride);
+            for (size_t h = 0; h < height; ++h) {
+                level_info info;
+                info.band = bands_.size();
+                info.shift = height - h;
+                info.offset = b.empty_tile.size();
+                levels_.push_back(info);
+                b.empty_tile.resize(b.empty_tile.size() + (1UL << (height - h)), zero_hashes[bottom + h]);
+            }
+            bands_.push_back(std::move(b));
+        }
+    }
+
+#ifndef __wasm__
+    /**
+     * A store over the band files in `directory`, whose bands hold `band_sizes[b]` nodes (as returned by `band_sizes`
+     * when they were committed).
+     */
+    static NodeStore map(std::vector<fr> const& zero_hashes,
+                         size_t tile_height,
+                         std::string const& directory,
+                         std::vector<size_t> const& band_sizes)
+    {
+        NodeStore store(zero_hashes, tile_height);
+        ASSERT(band_sizes.size() == store.bands_.size());
+        for (size_t i = 0; i < store.bands_.size(); ++i) {
+            auto& b = store.bands_[i];
+            b.nodes = Column<fr>::map(directory + "/nodes." + std::to_string(i), b.max_tiles * b.stride, band_sizes[i]);
+        }
+        return store;
+    }
+#endif
+
+    size_t num_bands() const { return bands_.size(); }
+
+    std::vector<size_t> band_sizes() const
+    {
+        std::vector<size_t> sizes;
+        for (const auto& b : bands_) {
+            sizes.push_back(b.nodes.size());
+        }
+        return sizes;
+    }
+
+    // Calls f(column) for each band's column, for IndexedMerkleTree::persist.
+    template <typename F> void for_each_column(F&& f)
+    {
+        for (auto& b : bands_) {
+            f(b.nodes);
+        }
+    }
+
+    // Where node (level, index) sits: which band, which of the band's tiles, and where within the tile.
+    struct location {
+        size_t band;
+        size_t tile;
+        size_t offset;
+    };
+
+    location locate(size_t level, size_t index) const
+    {
+        const auto& info = levels_[level];
+        return { info.band, index >> info.shift, info.offset + (index & ((1UL << info.shift) - 1)) };
+    }
+
+    size_t num_tiles(size_t band) const { return bands_[band].nodes.size() / bands_[band].stride; }
+
+    std::span<const fr> tile(size_t band, size_t tile) const
+    {
+        const auto& b = bands_[band];
+        return { b.nodes.begin() + tile * b.stride, b.stride };
+    }
+
+    fr get(size_t level, size_t index) const
+    {
+        const auto& info = levels_[level];
+        const auto& b = bands_[info.band];
+        const size_t slot = slot_of(info, b, index);
+        return slot < b.nodes.size() ? b.nodes[slot] : zero_hashes_[level];
+    }
+
+    void set(size_t level, size_t index, fr const& value)
+    {
+        const auto& info = levels_[level];
+        auto& b = bands_[info.band];
+        const size_t slot = slot_of(info, b, index);
+        while (slot >= b.nodes.size()) {
+            b.nodes.append(b.empty_tile.data(), b.empty_tile.data() + b.empty_tile.size());
+        }
+        b.nodes.set(slot, value);
+    }
+
+  private:
+    struct band {
+        // Nodes per tile.
+        size_t stride;
+        // Tiles in a full tree.
+        size_t max_tiles;
+        // A tile of empty-subtree hashes, copied in when a new tile is first written.
+        std::vector<fr> empty_tile;
+        Column<fr> nodes;
+    };
+
+    struct level_info {
+        size_t band;
+        // A tile spans 2^shift nodes of this level...
+        size_t shift;
+        // ...stored from this offset within the tile.
+        size_t offset;
+    };
+
+    static size_t slot_of(level_info const& info, band const& b, size_t index)
+    {
+        const size_t tile = index >> info.shift;
+        return tile * b.stride + info.offset + (index & ((1UL << info.shift) - 1));
+    }
+
+    std::vector<fr> zero_hashes_;
+    std::vector<level_info> levels_;
+    std::vector<band> bands_;
+};
+
+} // namespace indexed_merkle_tree
+} // namespace stdlib
+} // namespace plonk
@@ -0,0 +1,380 @@
+#ifndef __wasm__
+#include "indexed_merkle_tree.hpp"
+#include <cerrno>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace plonk {
+namespace stdlib {
+namespace indexed_merkle_tree {
+
+namespace {
+
+constexpr uint32_t HEADER_MAGIC = 0x494d5431;  // "IMT1"
+constexpr uint32_t JOURNAL_MAGIC = 0x494d544a; // "IMTJ"
+
+/**
+ * Everything needed to reopen a tree without touching its leaves. Serialised with the usual `serialize` helpers and
+ * followed by a checksum of those bytes.
+ */
+struct tree_header {
+    uint32_t depth;
+    uint32_t tile_height;
+    uint64_t sequence;
+    uint64_t num_leaves;
+    fr root;
+    std::vector<fr> zero_hashes;
+    std::vector<uint64_t> band_sizes;
+
+    void write(std::vector<uint8_t>& buf) const
+    {
+        using serialize::write;
+        write(buf, HEADER_MAGIC);
+        write(buf, depth);
+        write(buf, tile_height);
+        write(buf, sequence);
+        write(buf, num_leaves);
+        write(buf, root);
+        for (auto const& hash : zero_hashes) {
+            write(buf, hash);
+        }
+        write(buf, static_cast<uint32_t>(band_sizes.size()));
+        for (auto size : band_sizes) {
+            write(buf, size);
+        }
+    }
+
+    void read(uint8_t const*& it)
+    {
+        using serialize::read;
+        uint32_t magic = 0;
+        read(it, magic);
+        if (magic != HEADER_MAGIC) {
+            throw std::runtime_error("Not an indexed merkle tree header");
+        }
+        read(it, depth);
+        read(it, tile_height);
+        read(it, sequence);
+        read(it, num_leaves);
+        read(it, root);
+        zero_hashes.resize(depth + 1);
+        for (auto& hash : zero_hashes) {
+            read(it, hash);
+        }
+        uint32_t num_bands = 0;
+        read(it, num_bands);
+        band_sizes.resize(num_bands);
+        for (auto& size : band_sizes) {
+            read(it, size);
+        }
+    }
+};
+
+// FNV-1a; it only has to catch torn writes.
+uint64_t checksum(uint8_t const* data, size_t length)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void append_checksum(std::vector<uint8_t>& buf)
+{
+    using serialize::write;
+    write(buf, checksum(buf.data(), buf.size()));
+}
+
+bool has_valid_checksum(std::vector<uint8_t> const& buf)
+{
+    if (buf.size() < sizeof(uint64_t)) {
+        return false;
+    }
+    const size_t length = buf.size() - sizeof(uint64_t);
+    uint8_t const* it = buf.data() + length;
+    uint64_t expected = 0;
+    serialize::read(it, expected);
+    return checksum(buf.data(), length) == expected;
+}
+
+bool file_exists(std::string const& path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+std::vector<uint8_t> read_file(std::string const& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw io_error("open", path);
+    }
+    std::vector<uint8_t> buf;
+    uint8_t chunk[64 * 1024];
+    ssize_t n = 0;
+    while ((n = ::read(fd, chunk, sizeof(chunk))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            throw io_error("read", path);
+        }
+        buf.insert(buf.end(), chunk, chunk + n);
+    }
+    close(fd);
+    return buf;
+}
+
+void write_all(int fd, uint8_t const* data, size_t length, off_t offset, std::string const& path)
+{
+    while (length > 0) {
+        const ssize_t n = pwrite(fd, data, length, offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw io_error("write", path);
+        }
+        data += n;
+        length -= static_cast<size_t>(n);
+        offset += n;
+    }
+}
+
+void sync(int fd, std::string const& path)
+{
+    if (fsync(fd) != 0) {
+        throw io_error("fsync", path);
+    }
+}
+
+void sync_directory(std::string const& directory)
+{
+    const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0) {
+        throw io_error("open", directory);
+    }
+    const int rc = fsync(fd);
+    close(fd);
+    if (rc != 0) {
+        throw io_error("fsync", directory);
+    }
+}
+
+// Writes `buf` as the whole content of `path` and fsyncs it.
+void write_file(std::string const& path, std::vector<uint8_t> const& buf)
+{
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw io_error("open", path);
+    }
+    write_all(fd, buf.data(), buf.size(), 0, path);
+    sync(fd, path);
+    close(fd);
+}
+
+// Atomically replaces the header with `header`, which already carries its checksum.
+void install_header(std::string const& directory, std::vector<uint8_t> const& header)
+{
+    const std::string tmp = directory + "/header.tmp";
+    write_file(tmp, header);
+    if (rename(tmp.c_str(), (directory + "/header").c_str()) != 0) {
+        throw io_error("rename", tmp);
+    }
+    sync_directory(directory);
+}
+
+/**
+ * Brings the files of `directory` to a committed state after a crash. A journal is only ever left behind by a commit
+ * that did not finish: if it is complete, the commit record was durable, so its pages and header are written (again);
+ * if it is torn, the commit never started touching the files, and the journal is dropped.
+ *
+ * Journal layout: magic, header length and bytes, then (name length, name, offset, length, bytes) per page, and a
+ * checksum of everything before it.
+ */
+void recover(std::string const& directory)
+{
+    const std::string path = directory + "/journal";
+    if (!file_exists(path)) {
+        return;
+    }
+    const auto journal = read_file(path);
+    if (has_valid_checksum(journal)) {
+        using serialize::read;
+        uint8_t const* it = journal.data();
+        uint8_t const* const end = journal.data() + journal.size() - sizeof(uint64_t);
+        uint32_t magic = 0;
+        uint32_t header_length = 0;
+        read(it, magic);
+        if (magic != JOURNAL_MAGIC) {
+            throw std::runtime_error("Not an indexed merkle tree journal: " + path);
+        }
+        read(it, header_length);
+        const std::vector<uint8_t> header(it, it + header_length);
+        it += header_length;
+        while (it < end) {
+            uint32_t name_length = 0;
+            uint64_t offset = 0;
+            uint32_t length = 0;
+            read(it, name_length);
+            const std::string file = directory + "/" + std::string(it, it + name_length);
+            it += name_length;
+            read(it, offset);
+            read(it, length);
+            const int fd = ::open(file.c_str(), O_WRONLY | O_CREAT, 0644);
+            if (fd < 0) {
+                throw io_error("open", file);
+            }
+            write_all(fd, it, length, static_cast<off_t>(offset), file);
+            sync(fd, file);
+            close(fd);
+            it += length;
+        }
+        install_header(directory, header);
+    }
+    if (unlink(path.c_str()) != 0) {
+        throw io_error("unlink", path);
+    }
+    sync_directory(directory);
+}
+
+std::string file_name(MappedFile const& file)
+{
+    return file.path().substr(file.path().find_last_of('/') + 1);
+}
+
+} // namespace
+
+IndexedMerkleTree IndexedMerkleTree::open(std::string const& directory, size_t depth, size_t tile_height)
+{
+    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
+        throw io_error("mkdir", directory);
+    }
+    recover(directory);
+
+    if (!file_exists(directory + "/header")) {
+        IndexedMerkleTree tree(depth, tile_height);
+        tree.directory_ = directory;
+        tree.leaves_ = LeafStore::map(directory, tree.total_size_, 0);
+        tree.leaves_.push_back({ 0, 0, 0 });
+        tree.hashes_ = NodeStore::map(std::vector<fr>(tree.zero_hashes_.begin(), tree.zero_hashes_.end() - 1),
+                                      tile_height,
+                                      directory,
+                                      std::vector<size_t>(tree.hashes_.num_bands(), 0));
+        tree.persist();
+        return tree;
+    }
+
+    const auto buf = read_file(directory + "/header");
+    if (!has_valid_checksum(buf)) {
+        throw std::runtime_error("Corrupt indexed merkle tree header in " + directory);
+    }
+    tree_header header;
+    uint8_t const* it = buf.data();
+    header.read(it);
+    if (header.depth != depth) {
+        throw std::runtime_error("Indexed merkle tree in " + directory + " has depth " + std::to_string(header.depth));
+    }
+
+    IndexedMerkleTree tree;
+    tree.depth_ = header.depth;
+    tree.tile_height_ = header.tile_height;
+    tree.total_size_ = 1UL << tree.depth_;
+    tree.root_ = header.root;
+    tree.zero_hashes_ = header.zero_hashes;
+    tree.directory_ = directory;
+    tree.sequence_ = header.sequence;
+    tree.leaves_ = LeafStore::map(directory, tree.total_size_, header.num_leaves);
+    tree.hashes_ = NodeStore::map(std::vector<fr>(tree.zero_hashes_.begin(), tree.zero_hashes_.end() - 1),
+                                  tree.tile_height_,
+                                  directory,
+                                  std::vector<size_t>(header.band_sizes.begin(), header.band_sizes.end()));
+    tree.index_built_ = false;
+    return tree;
+}
+
+void IndexedMerkleTree::persist()
+{
+    if (directory_.empty()) {
+        return;
+    }
+
+    tree_header header;
+    header.depth = static_cast<uint32_t>(depth_);
+    header.tile_height = static_cast<uint32_t>(tile_height_);
+    header.sequence = sequence_ + 1;
+    header.num_leaves = leaves_.size();
+    header.root = root_;
+    header.zero_hashes = zero_hashes_;
+    for (auto size : hashes_.band_sizes()) {
+        header.band_sizes.push_back(size);
+    }
+    std::vector<uint8_t> header_buf;
+    header.write(header_buf);
+    append_checksum(header_buf);
+
+    // Calls f(file, live_bytes) for every column of the tree.
+    const auto for_each_file = [&](auto&& f) {
+        const auto visit = [&](auto& column) {
+            MappedFile* file = column.file();
+            ASSERT(file != nullptr);
+            f(*file, column.size() * sizeof(*column.begin()));
+        };
+        leaves_.for_each_column(visit);
+        hashes_.for_each_column(visit);
+    };
+
+    // 1. The commit record: once the journal is durable, recovery will finish this commit.
+    {
+        using serialize::write;
+        std::vector<uint8_t> journal;
+        write(journal, JOURNAL_MAGIC);
+        write(journal, static_cast<uint32_t>(header_buf.size()));
+        journal.insert(journal.end(), header_buf.begin(), header_buf.end());
+        for_each_file([&](MappedFile& file, size_t live_bytes) {
+            const std::string name = file_name(file);
+            file.for_each_dirty_page(live_bytes, [&](size_t offset, uint8_t const* bytes, size_t length) {
+                write(journal, static_cast<uint32_t>(name.size()));
+                journal.insert(journal.end(), name.begin(), name.end());
+                write(journal, static_cast<uint64_t>(offset));
+                write(journal, static_cast<uint32_t>(length));
+                journal.insert(journal.end(), bytes, bytes + length);
+            });
+        });
+        append_checksum(journal);
+        write_file(directory_ + "/journal", journal);
+        // The journal's directory entry must be durable too, or a crash could lose it along with pages already
+        // overwritten in place.
+        sync_directory(directory_);
+    }
+
+    // 2. Write the pages into place, then 3. swap in the new header and drop the journal.
+    for_each_file([&](MappedFile& file, size_t live_bytes) {
+        bool touched = false;
+        file.for_each_dirty_page(live_bytes, [&](size_t offset, uint8_t const* bytes, size_t length) {
+            write_all(file.fd(), bytes, length, static_cast<off_t>(offset), file.path());
+            touched = true;
+        });
+        if (touched) {
+            sync(file.fd(), file.path());
+        }
+    });
+    install_header(directory_, header_buf);
+    const std::string journal_path = directory_ + "/journal";
+    if (unlink(journal_path.c_str()) != 0) {
+        throw io_error("unlink", journal_path);
+    }
+    sync_directory(directory_);
+
+    for_each_file([](MappedFile& file, size_t) { file.clean(); });
+    sequence_ = header.sequence;
+}
+
+} // namespace indexed_merkle_tree
+} // namespace stdlib
+} // namespace plonk
+#endif
@@ -0,0 +1,168 @@
+#pragma once
+#include <numeric/uint256/uint256.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace plonk {
+namespace stdlib {
+namespace indexed_merkle_tree {
+
+/**
+ * An ordered map from (canonical) leaf values to leaf indices, used to find the low leaf of a new value.
+ *
+ * It is a two-level B+-tree: the keys live in sorted blocks of at most `MAX_BLOCK_SIZE` entries, and `firsts_` holds
+ * the smallest key of every block. A lookup is a binary search over `firsts_` followed by a binary search within one
+ * block, both over contiguous arrays of uint256_t. An insertion shifts the tail of one block, and splits the block in
+ * half once it overflows.
+ *
+ *          firsts_:   k_0          k_4              k_9
+ *                      |            |                |
+ *          blocks_:  [k_0 .. k_3] [k_4 .. k_8]     [k_9 .. k_11]
+ *                    [i_0 .. i_3] [i_4 .. i_8]     [i_9 .. i_11]
+ *
+ * Blocks are shared between copies and copied on write, so copying an index with `share` (as IndexedMerkleTree::publish
+ * does for every snapshot) costs one pointer per block, and an insertion afterwards copies only the block it lands in.
+ * Which blocks are shared is tracked explicitly, never read off the reference counts, which readers of the copies on
+ * other threads may be changing.
+ */
+class PredecessorIndex {
+  public:
+    static constexpr size_t MAX_BLOCK_SIZE = 512;
+
+    /**
+     * Adds `key` -> `index`. The key must not already be present.
+     */
+    void insert(uint256_t const& key, uint32_t index)
+    {
+        if (blocks_.empty()) {
+            blocks_.push_back(std::make_shared<block>());
+            shared_.push_back(false);
+            firsts_.push_back(key);
+        }
+        const size_t b = block_of(key);
+        auto& blk = writable(b);
+        const auto pos = std::upper_bound(blk.keys.begin(), blk.keys.end(), key) - blk.keys.begin();
+        blk.keys.insert(blk.keys.begin() + pos, key);
+        blk.indices.insert(blk.indices.begin() + pos, index);
+        firsts_[b] = blk.keys.front();
+        ++size_;
+
+        if (blk.keys.size() > MAX_BLOCK_SIZE) {
+            const auto half = static_cast<std::ptrdiff_t>(blk.keys.size() / 2);
+            block upper;
+            upper.keys.assign(blk.keys.begin() + half, blk.keys.end());
+            upper.indices.assign(blk.indices.begin() + half, blk.indices.end());
+            blk.keys.resize(static_cast<size_t>(half));
+            blk.indices.resize(static_cast<size_t>(half));
+            const auto next = static_cast<std::ptrdiff_t>(b + 1);
+            firsts_.insert(firsts_.begin() + next, upper.keys.front());
+            blocks_.insert(blocks_.begin() + next, std::make_shared<block>(std::move(upper)));
+            shared_.insert(shared_.begin() + next, false);
+        }
+    }
+
+    /**
+     * Removes `key`, which must be present. A block left empty is dropped; blocks are never merged.
+     */
+    void erase(uint256_t const& key)
+    {
+        const size_t b = block_of(key);
+        auto& blk = writable(b);
+        const auto pos = std::lower_bound(blk.keys.begin(), blk.keys.end(), key) - blk.keys.begin();
+        ASSERT(static_cast<size_t>(pos) < blk.keys.size() && blk.keys[static_cast<size_t>(pos)] == key);
+        blk.keys.erase(blk.keys.begin() + pos);
+        blk.indices.erase(blk.indices.begin() + pos);
+        --size_;
+        const auto at = static_cast<std::ptrdiff_t>(b);
+        if (blk.keys.empty()) {
+            blocks_.erase(blocks_.begin() + at);
+            shared_.erase(shared_.begin() + at);
+            firsts_.erase(firsts_.begin() + at);
+        } else {
+            firsts_[b] = blk.keys.front();
+        }
+    }
+
+    /**
+     * Replaces the contents with `entries`, whose keys must be distinct. Bulk loading sorts once and fills blocks to
+     * half of `MAX_BLOCK_SIZE`, leaving room for later insertions before the first split.
+     */
+    void assign(std::vector<std::pair<uint256_t, uint32_t>> entries)
+    {
+        std::sort(entries.begin(), entries.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+        blocks_.clear();
+        firsts_.clear();
+        for (size_t begin = 0; begin < entries.size(); begin += MAX_BLOCK_SIZE / 2) {
+            const size_t end = std::min(entries.size(), begin + MAX_BLOCK_SIZE / 2);
+            auto blk = std::make_shared<block>();
+            for (size_t i = begin; i < end; ++i) {
+                blk->keys.push_back(entries[i].first);
+                blk->indices.push_back(entries[i].second);
+            }
+            firsts_.push_back(blk->keys.front());
+            blocks_.push_back(std::move(blk));
+        }
+        shared_.assign(blocks_.size(), false);
+        size_ = entries.size();
+    }
+
+    /**
+     * A copy sharing every block with this index. The blocks are marked shared on both sides, so that whichever side
+     * writes to one next copies it first.
+     */
+    PredecessorIndex share()
+    {
+        shared_.assign(blocks_.size(), true);
+        return *this;
+    }
+
+    /**
+     * Returns the index stored under the largest key <= `key`, and whether that key is equal to `key`.
+     * There must be at least one key <= `key` (the tree always holds the zero leaf).
+     */
+    std::pair<uint32_t, bool> predecessor(uint256_t const& key) const
+    {
+        ASSERT(size_ > 0 && firsts_.front() <= key);
+        const auto& blk = *blocks_[block_of(key)];
+        const auto pos = std::upper_bound(blk.keys.begin(), blk.keys.end(), key) - blk.keys.begin() - 1;
+        return { blk.indices[static_cast<size_t>(pos)], blk.keys[static_cast<size_t>(pos)] == key };
+    }
+
+    size_t size() const { return size_; }
+
+  private:
+    struct block {
+        std::vector<uint256_t> keys;
+        std::vector<uint32_t> indices;
+    };
+
+    // The block whose range contains `key`: the last block starting at or below it, or the first block.
+    size_t block_of(uint256_t const& key) const
+    {
+        const auto it = std::upper_bound(firsts_.begin(), firsts_.end(), key);
+        return it == firsts_.begin() ? 0 : static_cast<size_t>(it - firsts_.begin() - 1);
+    }
+
+    // Block `b`, copied first if it was shared.
+    block& writable(size_t b)
+    {
+        if (shared_[b]) {
+            blocks_[b] = std::make_shared<block>(*blocks_[b]);
+            shared_[b] = false;
+        }
+        return *blocks_[b];
+    }
+
+    std::vector<std::shared_ptr<block>> blocks_;
+    // shared_[b]: whether blocks_[b] may also belong to another index
+    std::vector<bool> shared_;
+    std::vector<uint256_t> firsts_;
+    size_t size_ = 0;
+};
+
+} // namespace indexed_merkle_tree
+} // namespace stdlib
+} // namespace plonk
@@ -0,0 +1,130 @@
+#include "indexed_merkle_tree.hpp"
+#include <algorithm>
+
+namespace plonk {
+namespace stdlib {
+namespace indexed_merkle_tree {
+
+fr TreeSnapshot::get_node(size_t level, size_t index) const
+{
+    const auto loc = layout_->locate(level, index);
+    const auto& band = tiles_[loc.band];
+    if (loc.tile < band.size() && band[loc.tile] != nullptr) {
+        return (*band[loc.tile])[loc.offset];
+    }
+    return layout_->get(level, index);
+}
+
+fr_hash_path TreeSnapshot::get_hash_path(size_t index) const
+{
+    fr_hash_path path(depth_);
+    for (size_t i = 0; i < depth_; ++i) {
+        index &= ~1UL;
+        path[i] = std::make_pair(get_node(i, index), get_node(i, index + 1));
+        index >>= 1;
+    }
+    return path;
+}
+
+leaf TreeSnapshot::get_leaf(size_t index) const
+{
+    ASSERT(index < num_leaves_);
+    return (*leaf_pages_[index / LEAF_PAGE_SIZE])[index % LEAF_PAGE_SIZE];
+}
+
+low_leaf_witness TreeSnapshot::get_low_leaf_witness(fr const& value) const
+{
+    const size_t index = index_.predecessor(uint256_t(value)).first;
+    return { get_leaf(index), index, get_hash_path(index) };
+}
+
+void IndexedMerkleTree::enable_snapshots()
+{
+    ASSERT(snapshots_ == nullptr);
+    snapshots_ = std::make_unique<snapshot_state>();
+    snapshots_->layout =
+        std::make_shared<const NodeStore>(std::vector<fr>(zero_hashes_.begin(), zero_hashes_.end() - 1), tile_height_);
+
+    std::shared_ptr<TreeSnapshot> empty(new TreeSnapshot());
+    empty->depth_ = depth_;
+    empty->layout_ = snapshots_->layout;
+    empty->tiles_.resize(hashes_.num_bands());
+    snapshots_->latest = std::move(empty);
+
+    // The first publish copies everything.
+    for (size_t band = 0; band < hashes_.num_bands(); ++band) {
+        for (size_t tile = 0; tile < hashes_.num_tiles(band); ++tile) {
+            snapshots_->dirty_tiles.emplace_back(band, tile);
+        }
+    }
+    publish();
+}
+
+/**
+ * Builds the next snapshot from the previous one: copying it shares every tile, leaf page and index block, and then
+ * the tiles and pages written since are replaced by fresh copies. The previous snapshot is untouched, so readers still
+ * holding it are unaffected.
+ */
+void IndexedMerkleTree::publish()
+{
+    ASSERT(snapshots_ != nullptr);
+    auto& state = *snapshots_;
+    const auto previous = snapshot();
+    std::shared_ptr<TreeSnapshot> next(new TreeSnapshot(*previous));
+    next->root_ = root_;
+    next->num_leaves_ = leaves_.size();
+    next->version_ = previous->version_ + 1;
+
+    constexpr size_t page_size = TreeSnapshot::LEAF_PAGE_SIZE;
+    auto& pages = state.dirty_leaf_pages;
+    for (size_t page = state.published_leaves / page_size; page * page_size < leaves_.size(); ++page) {
+        pages.push_back(page);
+    }
+    std::sort(pages.begin(), pages.end());
+    pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+    next->leaf_pages_.resize((leaves_.size() + page_size - 1) / page_size);
+    for (size_t page : pages) {
+        if (page >= next->leaf_pages_.size()) {
+            break;
+        }
+        auto copy = std::make_shared<std::vector<leaf>>();
+        for (size_t i = page * page_size; i < std::min(leaves_.size(), (page + 1) * page_size); ++i) {
+            copy->push_back(leaves_[i]);
+        }
+        next->leaf_pages_[page] = std::move(copy);
+    }
+    pages.clear();
+    state.published_leaves = leaves_.size();
+
+    auto& tiles = state.dirty_tiles;
+    std::sort(tiles.begin(), tiles.end());
+    tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+    for (size_t band = 0; band < hashes_.num_bands(); ++band) {
+        next->tiles_[band].resize(hashes_.num_tiles(band));
+    }
+    for (auto [band, tile] : tiles) {
+        const auto nodes = hashes_.tile(band, tile);
+        next->tiles_[band][tile] = std::make_shared<const std::vector<fr>>(nodes.begin(), nodes.end());
+    }
+    tiles.clear();
+
+    index(); // built if need be
+    next->index_ = index_.share();
+    std::shared_ptr<const TreeSnapshot> published = std::move(next);
+    {
+        std::lock_guard lock(state.latest_mutex);
+        state.latest.swap(published);
+    }
+    // The previous snapshot, if this was its last owner, is freed outside the lock.
+}
+
+std::shared_ptr<const TreeSnapshot> IndexedMerkleTree::snapshot() const
+{
+    ASSERT(snapshots_ != nullptr);
+    std::lock_guard lock(snapshots_->latest_mutex);
+    return snapshots_->latest;
+}
+
+} // namespace indexed_merkle_tree
+} // namespace stdlib
+} // namespace plonk
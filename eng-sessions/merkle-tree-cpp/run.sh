@@ -12,8 +12,32 @@ clang++ \
   -O2 \
   -o merkle_test \
   sha256.cpp \
+  blake3.cpp \
+  blake3_sse41.cpp \
+  blake3_avx2.cpp \
+  blake3_avx512.cpp \
   main.cpp
 
+clang++ \
+  -std=c++20 \
+  -Wall -Wextra \
+  -O2 \
+  -o proof_server \
+  sha256.cpp \
+  blake3.cpp \
+  blake3_sse41.cpp \
+  blake3_avx2.cpp \
+  blake3_avx512.cpp \
+  proof_server.cpp
+
+clang++ \
+  -std=c++20 \
+  -Wall -Wextra \
+  -O2 \
+  -pthread \
+  -o proof_loadgen \
+  proof_loadgen.cpp
+
 echo "Running tests."
 ./merkle_test
 
@@ -0,0 +1,418 @@
+#include "blake3.hpp"
+#include "blake3_impl.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace blake3 {
+namespace detail {
+
+namespace {
+
+inline uint32_t rotr32(uint32_t w, uint32_t c)
+{
+    return (w >> c) | (w << (32 - c));
+}
+
+inline void g(uint32_t* state, size_t a, size_t b, size_t c, size_t d, uint32_t x, uint32_t y)
+{
+    state[a] = state[a] + state[b] + x;
+    state[d] = rotr32(state[d] ^ state[a], 16);
+    state[c] = state[c] + state[d];
+    state[b] = rotr32(state[b] ^ state[c], 12);
+    state[a] = state[a] + state[b] + y;
+    state[d] = rotr32(state[d] ^ state[a], 8);
+    state[c] = state[c] + state[d];
+    state[b] = rotr32(state[b] ^ state[c], 7);
+}
+
+inline void round_fn(uint32_t state[16], const uint32_t* msg, size_t round)
+{
+    const auto& schedule = MSG_SCHEDULE[round];
+
+    // Mix the columns.
+    g(state, 0, 4, 8, 12, msg[schedule[0]], msg[schedule[1]]);
+    g(state, 1, 5, 9, 13, msg[schedule[2]], msg[schedule[3]]);
+    g(state, 2, 6, 10, 14, msg[schedule[4]], msg[schedule[5]]);
+    g(state, 3, 7, 11, 15, msg[schedule[6]], msg[schedule[7]]);
+
+    // Mix the diagonals.
+    g(state, 0, 5, 10, 15, msg[schedule[8]], msg[schedule[9]]);
+    g(state, 1, 6, 11, 12, msg[schedule[10]], msg[schedule[11]]);
+    g(state, 2, 7, 8, 13, msg[schedule[12]], msg[schedule[13]]);
+    g(state, 3, 4, 9, 14, msg[schedule[14]], msg[schedule[15]]);
+}
+
+inline void compress_pre(uint32_t state[16],
+                         const uint32_t cv[8],
+                         const uint8_t block[BLOCK_LEN],
+                         uint8_t block_len,
+                         uint64_t counter,
+                         uint8_t flags)
+{
+    uint32_t block_words[16];
+    for (size_t i = 0; i < 16; ++i) {
+        block_words[i] = load32(block + 4 * i);
+    }
+
+    for (size_t i = 0; i < 8; ++i) {
+        state[i] = cv[i];
+        state[i + 8] = i < 4 ? IV[i] : 0;
+    }
+    state[12] = counter_low(counter);
+    state[13] = counter_high(counter);
+    state[14] = static_cast<uint32_t>(block_len);
+    state[15] = static_cast<uint32_t>(flags);
+
+    for (size_t r = 0; r < 7; ++r) {
+        round_fn(state, &block_words[0], r);
+    }
+}
+
+using compress_fn = void (*)(uint32_t*, const uint8_t*, uint8_t, uint64_t, uint8_t);
+using hash_many_fn = void (*)(const uint8_t* const*,
+                              size_t,
+                              size_t,
+                              const uint32_t*,
+                              uint64_t,
+                              bool,
+                              uint8_t,
+                              uint8_t,
+                              uint8_t,
+                              uint8_t*);
+
+compress_fn select_compress(backend b)
+{
+#ifdef BLAKE3_X86
+    switch (b) {
+    case backend::avx512:
+        return &compress_in_place_avx512;
+    case backend::avx2:
+    case backend::sse41:
+        return &compress_in_place_sse41;
+    case backend::portable:
+        break;
+    }
+#else
+    (void)b;
+#endif
+    return &compress_in_place_portable;
+}
+
+hash_many_fn select_hash_many(backend b)
+{
+#ifdef BLAKE3_X86
+    switch (b) {
+    case backend::avx512:
+        return &hash_many_avx512;
+    case backend::avx2:
+        return &hash_many_avx2;
+    case backend::sse41:
+        return &hash_many_sse41;
+    case backend::portable:
+        break;
+    }
+#else
+    (void)b;
+#endif
+    return &hash_many_portable;
+}
+
+// Resolved once, on first use.
+compress_fn active_compress()
+{
+    static const compress_fn fn = select_compress(detect_backend());
+    return fn;
+}
+
+hash_many_fn active_hash_many()
+{
+    static const hash_many_fn fn = select_hash_many(detect_backend());
+    return fn;
+}
+
+} // namespace
+
+void compress_in_place_portable(
+    uint32_t cv[8], const uint8_t block[BLOCK_LEN], uint8_t block_len, uint64_t counter, uint8_t flags)
+{
+    uint32_t state[16];
+    compress_pre(state, cv, block, block_len, counter, flags);
+    for (size_t i = 0; i < 8; ++i) {
+        cv[i] = state[i] ^ state[i + 8];
+    }
+}
+
+void hash_many_portable(const uint8_t* const* inputs,
+                        size_t num_inputs,
+                        size_t blocks,
+                        const uint32_t key[8],
+                        uint64_t counter,
+                        bool increment_counter,
+                        uint8_t flags,
+                        uint8_t flags_start,
+                        uint8_t flags_end,
+                        uint8_t* out)
+{
+    for (size_t i = 0; i < num_inputs; ++i) {
+        uint32_t cv[8];
+        std::memcpy(cv, key, sizeof(cv));
+        uint8_t block_flags = flags | flags_start;
+        for (size_t b = 0; b < blocks; ++b) {
+            if (b + 1 == blocks) {
+                block_flags |= flags_end;
+            }
+            compress_in_place_portable(cv, inputs[i] + b * BLOCK_LEN, BLOCK_LEN, counter, block_flags);
+            block_flags = flags;
+        }
+        store_cv_words(out + i * OUT_LEN, cv);
+        if (increment_counter) {
+            counter += 1;
+        }
+    }
+}
+
+} // namespace detail
+
+backend detect_backend()
+{
+    static const backend detected = [] {
+#if defined(BLAKE3_X86) && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl")) {
+            return backend::avx512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return backend::avx2;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+            return backend::sse41;
+        }
+#endif
+        return backend::portable;
+    }();
+    return detected;
+}
+
+size_t simd_degree(backend b)
+{
+    switch (b) {
+    case backend::avx512:
+        return 16;
+    case backend::avx2:
+        return 8;
+    case backend::sse41:
+        return 4;
+    case backend::portable:
+        break;
+    }
+    return 1;
+}
+
+void compress_in_place(uint32_t cv[8],
+                       const uint8_t block[BLOCK_LEN],
+                       uint8_t block_len,
+                       uint64_t counter,
+                       uint8_t flags)
+{
+    detail::active_compress()(cv, block, block_len, counter, flags);
+}
+
+void hash_many(const uint8_t* const* inputs,
+               size_t num_inputs,
+               size_t blocks,
+               const uint32_t key[8],
+               uint64_t counter,
+               bool increment_counter,
+               uint8_t flags,
+               uint8_t flags_start,
+               uint8_t flags_end,
+               uint8_t* out)
+{
+    detail::active_hash_many()(
+        inputs, num_inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+}
+
+void hash_many(backend b,
+               const uint8_t* const* inputs,
+               size_t num_inputs,
+               size_t blocks,
+               const uint32_t key[8],
+               uint64_t counter,
+               bool increment_counter,
+               uint8_t flags,
+               uint8_t flags_start,
+               uint8_t flags_end,
+               uint8_t* out)
+{
+    detail::select_hash_many(b)(
+        inputs, num_inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+}
+
+} // namespace blake3
+
+using namespace blake3;
+using namespace blake3::detail;
+
+void BLAKE3::output::chaining_value(uint32_t out_cv[8]) const
+{
+    std::memcpy(out_cv, input_cv, 32);
+    compress_in_place(out_cv, block, block_len, counter, flags);
+}
+
+std::array<uint8_t, 32> BLAKE3::output::root_bytes() const
+{
+    // A 32-byte digest is the first block of the root output, i.e. output block counter 0.
+    uint32_t out_cv[8];
+    std::memcpy(out_cv, input_cv, 32);
+    compress_in_place(out_cv, block, block_len, 0, flags | ROOT);
+    std::array<uint8_t, 32> hash;
+    store_cv_words(hash.data(), out_cv);
+    return hash;
+}
+
+BLAKE3::BLAKE3()
+    : cv_stack_len(0)
+{
+    reset_chunk(0);
+}
+
+void BLAKE3::reset_chunk(uint64_t counter)
+{
+    std::memcpy(cv, IV.data(), 32);
+    chunk_counter = counter;
+    std::memset(buf, 0, sizeof(buf));
+    buf_len = 0;
+    blocks_compressed = 0;
+}
+
+size_t BLAKE3::chunk_len() const
+{
+    return BLOCK_LEN * blocks_compressed + buf_len;
+}
+
+uint8_t BLAKE3::chunk_start_flag() const
+{
+    return blocks_compressed == 0 ? CHUNK_START : 0;
+}
+
+void BLAKE3::chunk_update(const uint8_t* input, size_t length)
+{
+    while (length > 0) {
+        // Only compress a full buffer once more input arrives: the last block of a chunk needs CHUNK_END.
+        if (buf_len == BLOCK_LEN) {
+            compress_in_place(cv, buf, BLOCK_LEN, chunk_counter, chunk_start_flag());
+            blocks_compressed += 1;
+            std::memset(buf, 0, sizeof(buf));
+            buf_len = 0;
+        }
+        const size_t take = std::min(BLOCK_LEN - buf_len, length);
+        std::memcpy(buf + buf_len, input, take);
+        buf_len = static_cast<uint8_t>(buf_len + take);
+        input += take;
+        length -= take;
+    }
+}
+
+BLAKE3::output BLAKE3::chunk_output() const
+{
+    output out;
+    std::memcpy(out.input_cv, cv, 32);
+    std::memcpy(out.block, buf, BLOCK_LEN);
+    out.block_len = buf_len;
+    out.counter = chunk_counter;
+    out.flags = chunk_start_flag() | CHUNK_END;
+    return out;
+}
+
+BLAKE3::output BLAKE3::parent_output(const uint32_t left[8], const uint32_t right[8])
+{
+    output out;
+    std::memcpy(out.input_cv, IV.data(), 32);
+    store_cv_words(out.block, left);
+    store_cv_words(out.block + 32, right);
+    out.block_len = BLOCK_LEN;
+    out.counter = 0;
+    out.flags = PARENT;
+    return out;
+}
+
+void BLAKE3::push_chunk_cv(const uint32_t new_cv[8], uint64_t total_chunks)
+{
+    // Merge completed subtrees: every trailing zero bit of the chunk count closes one.
+    uint32_t merged[8];
+    std::memcpy(merged, new_cv, 32);
+    while ((total_chunks & 1) == 0) {
+        cv_stack_len -= 1;
+        parent_output(cv_stack[cv_stack_len], merged).chaining_value(merged);
+        total_chunks >>= 1;
+    }
+    std::memcpy(cv_stack[cv_stack_len], merged, 32);
+    cv_stack_len += 1;
+}
+
+void BLAKE3::update(const uint8_t* new_data, size_t length)
+{
+    // Finish a partially filled chunk first.
+    if (chunk_len() > 0) {
+        const size_t take = std::min(CHUNK_LEN - chunk_len(), length);
+        chunk_update(new_data, take);
+        new_data += take;
+        length -= take;
+        if (length == 0) {
+            return;
+        }
+        uint32_t chunk_cv[8];
+        chunk_output().chaining_value(chunk_cv);
+        push_chunk_cv(chunk_cv, chunk_counter + 1);
+        reset_chunk(chunk_counter + 1);
+    }
+
+    // Whole chunks that are known not to be the last one are hashed side by side.
+    const size_t degree = simd_degree(detect_backend());
+    while (length > CHUNK_LEN) {
+        const size_t num_chunks = std::min(degree, (length - 1) / CHUNK_LEN);
+        const uint8_t* chunk_ptrs[16];
+        uint8_t chunk_cvs[16 * OUT_LEN];
+        for (size_t i = 0; i < num_chunks; ++i) {
+            chunk_ptrs[i] = new_data + i * CHUNK_LEN;
+        }
+        hash_many(&chunk_ptrs[0],
+                  num_chunks,
+                  CHUNK_LEN / BLOCK_LEN,
+                  IV.data(),
+                  chunk_counter,
+                  true,
+                  0,
+                  CHUNK_START,
+                  CHUNK_END,
+                  &chunk_cvs[0]);
+        for (size_t i = 0; i < num_chunks; ++i) {
+            uint32_t chunk_cv[8];
+            for (size_t w = 0; w < 8; ++w) {
+                chunk_cv[w] = load32(&chunk_cvs[i * OUT_LEN + w * 4]);
+            }
+            push_chunk_cv(chunk_cv, chunk_counter + 1);
+            reset_chunk(chunk_counter + 1);
+        }
+        new_data += num_chunks * CHUNK_LEN;
+        length -= num_chunks * CHUNK_LEN;
+    }
+
+    chunk_update(new_data, length);
+}
+
+void BLAKE3::update(const std::string& new_data)
+{
+    update(reinterpret_cast<const uint8_t*>(new_data.c_str()), new_data.size());
+}
+
+std::array<uint8_t, 32> BLAKE3::digest() const
+{
+    output out = chunk_output();
+    for (size_t i = cv_stack_len; i > 0; --i) {
+        uint32_t right[8];
+        out.chaining_value(right);
+        out = parent_output(cv_stack[i - 1], right);
+    }
+    return out.root_bytes();
+}
@@ -0,0 +1,129 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * BLAKE3 (unkeyed, 32-byte output) with runtime-dispatched SIMD kernels.
+ *
+ * Single 64-byte blocks - which is all a merkle node or a 64-byte leaf ever needs - go through one call to
+ * `blake3::compress_in_place`. Multiple independent inputs of the same length can be hashed side by side with
+ * `blake3::hash_many`, which transposes them into 4 (SSE4.1), 8 (AVX2) or 16 (AVX-512) lanes.
+ */
+namespace blake3 {
+
+constexpr size_t BLOCK_LEN = 64;
+constexpr size_t CHUNK_LEN = 1024;
+constexpr size_t OUT_LEN = 32;
+
+constexpr std::array<uint32_t, 8> IV = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+};
+
+enum flags : uint8_t {
+    CHUNK_START = 1 << 0,
+    CHUNK_END = 1 << 1,
+    PARENT = 1 << 2,
+    ROOT = 1 << 3,
+};
+
+enum class backend {
+    portable,
+    sse41,
+    avx2,
+    avx512,
+};
+
+/**
+ * The best backend supported by the running CPU. Detected once.
+ */
+backend detect_backend();
+
+/**
+ * Number of inputs `hash_many` processes at once on the given backend.
+ */
+size_t simd_degree(backend b);
+
+/**
+ * Compress one block into the chaining value `cv`.
+ */
+void compress_in_place(uint32_t cv[8],
+                       const uint8_t block[BLOCK_LEN],
+                       uint8_t block_len,
+                       uint64_t counter,
+                       uint8_t flags);
+
+/**
+ * Hash `num_inputs` inputs of `blocks` full blocks each, writing one 32-byte chaining value per input to `out`.
+ * Input i is compressed with counter `counter + i` when `increment_counter` is set. `flags_start` / `flags_end` are
+ * added to the first / last block of every input on top of `flags`.
+ */
+void hash_many(const uint8_t* const* inputs,
+               size_t num_inputs,
+               size_t blocks,
+               const uint32_t key[8],
+               uint64_t counter,
+               bool increment_counter,
+               uint8_t flags,
+               uint8_t flags_start,
+               uint8_t flags_end,
+               uint8_t* out);
+
+/**
+ * As above, on an explicitly chosen backend. The backend must be supported by the running CPU.
+ */
+void hash_many(backend b,
+               const uint8_t* const* inputs,
+               size_t num_inputs,
+               size_t blocks,
+               const uint32_t key[8],
+               uint64_t counter,
+               bool increment_counter,
+               uint8_t flags,
+               uint8_t flags_start,
+               uint8_t flags_end,
+               uint8_t* out);
+
+} // namespace blake3
+
+class BLAKE3 {
+
+  public:
+    BLAKE3();
+    void update(const uint8_t* new_data, size_t length);
+    void update(const std::string& new_data);
+    std::array<uint8_t, 32> digest() const;
+
+  private:
+    struct output {
+        uint32_t input_cv[8];
+        uint8_t block[blake3::BLOCK_LEN];
+        uint8_t block_len;
+        uint64_t counter;
+        uint8_t flags;
+
+        void chaining_value(uint32_t cv[8]) const;
+        std::array<uint8_t, 32> root_bytes() const;
+    };
+
+    // Current chunk.
+    uint32_t cv[8];
+    uint64_t chunk_counter;
+    uint8_t buf[blake3::BLOCK_LEN];
+    uint8_t buf_len;
+    uint8_t blocks_compressed;
+
+    // Chaining values of completed subtrees, one per set bit of the number of completed chunks.
+    uint32_t cv_stack[54][8];
+    uint8_t cv_stack_len;
+
+    size_t chunk_len() const;
+    uint8_t chunk_start_flag() const;
+    void chunk_update(const uint8_t* input, size_t length);
+    output chunk_output() const;
+    void push_chunk_cv(const uint32_t new_cv[8], uint64_t total_chunks);
+    void reset_chunk(uint64_t counter);
+
+    static output parent_output(const uint32_t left[8], const uint32_t right[8]);
+};
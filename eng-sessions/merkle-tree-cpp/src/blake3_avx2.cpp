@@ -0,0 +1,196 @@
+#include "blake3_impl.hpp"
+
+#ifdef BLAKE3_X86
+#include <immintrin.h>
+
+namespace blake3::detail {
+
+namespace {
+
+#define AVX2 BLAKE3_TARGET("avx2")
+
+AVX2 inline __m256i add(__m256i a, __m256i b)
+{
+    return _mm256_add_epi32(a, b);
+}
+
+AVX2 inline __m256i xorv(__m256i a, __m256i b)
+{
+    return _mm256_xor_si256(a, b);
+}
+
+AVX2 inline __m256i set1(uint32_t x)
+{
+    return _mm256_set1_epi32(static_cast<int32_t>(x));
+}
+
+AVX2 inline __m256i rot16(__m256i x)
+{
+    return _mm256_shuffle_epi8(x,
+                               _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2,
+                                               13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2));
+}
+
+AVX2 inline __m256i rot12(__m256i x)
+{
+    return _mm256_or_si256(_mm256_srli_epi32(x, 12), _mm256_slli_epi32(x, 32 - 12));
+}
+
+AVX2 inline __m256i rot8(__m256i x)
+{
+    return _mm256_shuffle_epi8(x,
+                               _mm256_set_epi8(12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1,
+                                               12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1));
+}
+
+AVX2 inline __m256i rot7(__m256i x)
+{
+    return _mm256_or_si256(_mm256_srli_epi32(x, 7), _mm256_slli_epi32(x, 32 - 7));
+}
+
+AVX2 inline void g(__m256i& a, __m256i& b, __m256i& c, __m256i& d, __m256i mx, __m256i my)
+{
+    a = add(add(a, mx), b);
+    d = rot16(xorv(d, a));
+    c = add(c, d);
+    b = rot12(xorv(b, c));
+    a = add(add(a, my), b);
+    d = rot8(xorv(d, a));
+    c = add(c, d);
+    b = rot7(xorv(b, c));
+}
+
+AVX2 inline void round_fn8(__m256i v[16], const __m256i m[16], size_t r)
+{
+    const auto& s = MSG_SCHEDULE[r];
+    g(v[0], v[4], v[8], v[12], m[s[0]], m[s[1]]);
+    g(v[1], v[5], v[9], v[13], m[s[2]], m[s[3]]);
+    g(v[2], v[6], v[10], v[14], m[s[4]], m[s[5]]);
+    g(v[3], v[7], v[11], v[15], m[s[6]], m[s[7]]);
+    g(v[0], v[5], v[10], v[15], m[s[8]], m[s[9]]);
+    g(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+    g(v[2], v[7], v[8], v[13], m[s[12]], m[s[13]]);
+    g(v[3], v[4], v[9], v[14], m[s[14]], m[s[15]]);
+}
+
+/**
+ * 8x8 transpose of 32-bit words: on entry v[i] holds 8 words of input i, on exit v[j] holds word j of every input.
+ */
+AVX2 inline void transpose(__m256i v[8])
+{
+    const __m256i ab_0145 = _mm256_unpacklo_epi32(v[0], v[1]);
+    const __m256i ab_2367 = _mm256_unpackhi_epi32(v[0], v[1]);
+    const __m256i cd_0145 = _mm256_unpacklo_epi32(v[2], v[3]);
+    const __m256i cd_2367 = _mm256_unpackhi_epi32(v[2], v[3]);
+    const __m256i ef_0145 = _mm256_unpacklo_epi32(v[4], v[5]);
+    const __m256i ef_2367 = _mm256_unpackhi_epi32(v[4], v[5]);
+    const __m256i gh_0145 = _mm256_unpacklo_epi32(v[6], v[7]);
+    const __m256i gh_2367 = _mm256_unpackhi_epi32(v[6], v[7]);
+
+    const __m256i abcd_04 = _mm256_unpacklo_epi64(ab_0145, cd_0145);
+    const __m256i abcd_15 = _mm256_unpackhi_epi64(ab_0145, cd_0145);
+    const __m256i abcd_26 = _mm256_unpacklo_epi64(ab_2367, cd_2367);
+    const __m256i abcd_37 = _mm256_unpackhi_epi64(ab_2367, cd_2367);
+    const __m256i efgh_04 = _mm256_unpacklo_epi64(ef_0145, gh_0145);
+    const __m256i efgh_15 = _mm256_unpackhi_epi64(ef_0145, gh_0145);
+    const __m256i efgh_26 = _mm256_unpacklo_epi64(ef_2367, gh_2367);
+    const __m256i efgh_37 = _mm256_unpackhi_epi64(ef_2367, gh_2367);
+
+    v[0] = _mm256_permute2x128_si256(abcd_04, efgh_04, 0x20);
+    v[1] = _mm256_permute2x128_si256(abcd_15, efgh_15, 0x20);
+    v[2] = _mm256_permute2x128_si256(abcd_26, efgh_26, 0x20);
+    v[3] = _mm256_permute2x128_si256(abcd_37, efgh_37, 0x20);
+    v[4] = _mm256_permute2x128_si256(abcd_04, efgh_04, 0x31);
+    v[5] = _mm256_permute2x128_si256(abcd_15, efgh_15, 0x31);
+    v[6] = _mm256_permute2x128_si256(abcd_26, efgh_26, 0x31);
+    v[7] = _mm256_permute2x128_si256(abcd_37, efgh_37, 0x31);
+}
+
+AVX2 void hash8(const uint8_t* const* inputs,
+                size_t blocks,
+                const uint32_t key[8],
+                uint64_t counter,
+                bool increment_counter,
+                uint8_t flags,
+                uint8_t flags_start,
+                uint8_t flags_end,
+                uint8_t* out)
+{
+    __m256i h[8];
+    for (size_t i = 0; i < 8; ++i) {
+        h[i] = set1(key[i]);
+    }
+    alignas(32) uint32_t lo[8];
+    alignas(32) uint32_t hi[8];
+    for (size_t lane = 0; lane < 8; ++lane) {
+        const uint64_t c = counter + (increment_counter ? lane : 0);
+        lo[lane] = counter_low(c);
+        hi[lane] = counter_high(c);
+    }
+    const __m256i counter_lo = _mm256_load_si256(reinterpret_cast<const __m256i*>(lo));
+    const __m256i counter_hi = _mm256_load_si256(reinterpret_cast<const __m256i*>(hi));
+
+    uint8_t block_flags = flags | flags_start;
+    for (size_t b = 0; b < blocks; ++b) {
+        if (b + 1 == blocks) {
+            block_flags |= flags_end;
+        }
+        __m256i m[16];
+        for (size_t half = 0; half < 2; ++half) {
+            for (size_t lane = 0; lane < 8; ++lane) {
+                m[8 * half + lane] =
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inputs[lane] + b * BLOCK_LEN + 32 * half));
+            }
+            transpose(&m[8 * half]);
+        }
+
+        __m256i v[16] = {
+            h[0],        h[1],        h[2],        h[3],       h[4],       h[5],
+            h[6],        h[7],        set1(IV[0]), set1(IV[1]), set1(IV[2]), set1(IV[3]),
+            counter_lo,  counter_hi,  set1(BLOCK_LEN), set1(block_flags),
+        };
+        for (size_t r = 0; r < 7; ++r) {
+            round_fn8(v, m, r);
+        }
+        for (size_t i = 0; i < 8; ++i) {
+            h[i] = xorv(v[i], v[i + 8]);
+        }
+        block_flags = flags;
+    }
+
+    transpose(h);
+    for (size_t lane = 0; lane < 8; ++lane) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + lane * OUT_LEN), h[lane]);
+    }
+}
+
+} // namespace
+
+AVX2 void hash_many_avx2(const uint8_t* const* inputs,
+                         size_t num_inputs,
+                         size_t blocks,
+                         const uint32_t key[8],
+                         uint64_t counter,
+                         bool increment_counter,
+                         uint8_t flags,
+                         uint8_t flags_start,
+                         uint8_t flags_end,
+                         uint8_t* out)
+{
+    while (num_inputs >= 8) {
+        hash8(inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+        if (increment_counter) {
+            counter += 8;
+        }
+        inputs += 8;
+        num_inputs -= 8;
+        out += 8 * OUT_LEN;
+    }
+    hash_many_sse41(inputs, num_inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+}
+
+#undef AVX2
+
+} // namespace blake3::detail
+
+#endif
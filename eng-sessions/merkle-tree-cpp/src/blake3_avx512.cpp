@@ -0,0 +1,229 @@
+#include "blake3_impl.hpp"
+
+#ifdef BLAKE3_X86
+#include <immintrin.h>
+
+// GCC flags the deliberately undefined pass-through operand inside the AVX-512 unpack intrinsics.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace blake3::detail {
+
+namespace {
+
+#define AVX512 BLAKE3_TARGET("avx512f,avx512vl")
+
+AVX512 inline __m512i add(__m512i a, __m512i b)
+{
+    return _mm512_add_epi32(a, b);
+}
+
+AVX512 inline __m512i xorv(__m512i a, __m512i b)
+{
+    return _mm512_xor_si512(a, b);
+}
+
+AVX512 inline __m512i set1(uint32_t x)
+{
+    return _mm512_set1_epi32(static_cast<int32_t>(x));
+}
+
+AVX512 inline void g(__m512i& a, __m512i& b, __m512i& c, __m512i& d, __m512i mx, __m512i my)
+{
+    a = add(add(a, mx), b);
+    d = _mm512_ror_epi32(xorv(d, a), 16);
+    c = add(c, d);
+    b = _mm512_ror_epi32(xorv(b, c), 12);
+    a = add(add(a, my), b);
+    d = _mm512_ror_epi32(xorv(d, a), 8);
+    c = add(c, d);
+    b = _mm512_ror_epi32(xorv(b, c), 7);
+}
+
+AVX512 inline __m128i set4(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    return _mm_setr_epi32(
+        static_cast<int32_t>(a), static_cast<int32_t>(b), static_cast<int32_t>(c), static_cast<int32_t>(d));
+}
+
+AVX512 inline void g1(__m128i& row0, __m128i& row1, __m128i& row2, __m128i& row3, __m128i m)
+{
+    row0 = _mm_add_epi32(_mm_add_epi32(row0, m), row1);
+    row3 = _mm_ror_epi32(_mm_xor_si128(row3, row0), 16);
+    row2 = _mm_add_epi32(row2, row3);
+    row1 = _mm_ror_epi32(_mm_xor_si128(row1, row2), 12);
+}
+
+AVX512 inline void g2(__m128i& row0, __m128i& row1, __m128i& row2, __m128i& row3, __m128i m)
+{
+    row0 = _mm_add_epi32(_mm_add_epi32(row0, m), row1);
+    row3 = _mm_ror_epi32(_mm_xor_si128(row3, row0), 8);
+    row2 = _mm_add_epi32(row2, row3);
+    row1 = _mm_ror_epi32(_mm_xor_si128(row1, row2), 7);
+}
+
+AVX512 inline void round_fn16(__m512i v[16], const __m512i m[16], size_t r)
+{
+    const auto& s = MSG_SCHEDULE[r];
+    g(v[0], v[4], v[8], v[12], m[s[0]], m[s[1]]);
+    g(v[1], v[5], v[9], v[13], m[s[2]], m[s[3]]);
+    g(v[2], v[6], v[10], v[14], m[s[4]], m[s[5]]);
+    g(v[3], v[7], v[11], v[15], m[s[6]], m[s[7]]);
+    g(v[0], v[5], v[10], v[15], m[s[8]], m[s[9]]);
+    g(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+    g(v[2], v[7], v[8], v[13], m[s[12]], m[s[13]]);
+    g(v[3], v[4], v[9], v[14], m[s[14]], m[s[15]]);
+}
+
+/**
+ * 16x16 transpose of 32-bit words. Within each 128-bit lane it is the usual unpack transpose of 4x4 blocks; the
+ * 128-bit lanes are then transposed as a 4x4 matrix of their own.
+ */
+AVX512 inline void transpose(__m512i v[16])
+{
+    __m512i u[16];
+    for (size_t grp = 0; grp < 4; ++grp) {
+        __m512i* r = &v[4 * grp];
+        const __m512i ab_lo = _mm512_unpacklo_epi32(r[0], r[1]);
+        const __m512i ab_hi = _mm512_unpackhi_epi32(r[0], r[1]);
+        const __m512i cd_lo = _mm512_unpacklo_epi32(r[2], r[3]);
+        const __m512i cd_hi = _mm512_unpackhi_epi32(r[2], r[3]);
+        // u[4 * grp + j] lane k = word 4k + j of inputs 4 * grp .. 4 * grp + 3.
+        u[4 * grp + 0] = _mm512_unpacklo_epi64(ab_lo, cd_lo);
+        u[4 * grp + 1] = _mm512_unpackhi_epi64(ab_lo, cd_lo);
+        u[4 * grp + 2] = _mm512_unpacklo_epi64(ab_hi, cd_hi);
+        u[4 * grp + 3] = _mm512_unpackhi_epi64(ab_hi, cd_hi);
+    }
+    for (size_t j = 0; j < 4; ++j) {
+        const __m512i x0 = _mm512_shuffle_i32x4(u[j], u[4 + j], _MM_SHUFFLE(1, 0, 1, 0));
+        const __m512i x1 = _mm512_shuffle_i32x4(u[j], u[4 + j], _MM_SHUFFLE(3, 2, 3, 2));
+        const __m512i x2 = _mm512_shuffle_i32x4(u[8 + j], u[12 + j], _MM_SHUFFLE(1, 0, 1, 0));
+        const __m512i x3 = _mm512_shuffle_i32x4(u[8 + j], u[12 + j], _MM_SHUFFLE(3, 2, 3, 2));
+        v[j] = _mm512_shuffle_i32x4(x0, x2, _MM_SHUFFLE(2, 0, 2, 0));
+        v[4 + j] = _mm512_shuffle_i32x4(x0, x2, _MM_SHUFFLE(3, 1, 3, 1));
+        v[8 + j] = _mm512_shuffle_i32x4(x1, x3, _MM_SHUFFLE(2, 0, 2, 0));
+        v[12 + j] = _mm512_shuffle_i32x4(x1, x3, _MM_SHUFFLE(3, 1, 3, 1));
+    }
+}
+
+AVX512 void hash16(const uint8_t* const* inputs,
+                   size_t blocks,
+                   const uint32_t key[8],
+                   uint64_t counter,
+                   bool increment_counter,
+                   uint8_t flags,
+                   uint8_t flags_start,
+                   uint8_t flags_end,
+                   uint8_t* out)
+{
+    __m512i h[16];
+    for (size_t i = 0; i < 8; ++i) {
+        h[i] = set1(key[i]);
+    }
+    alignas(64) uint32_t lo[16];
+    alignas(64) uint32_t hi[16];
+    for (size_t lane = 0; lane < 16; ++lane) {
+        const uint64_t c = counter + (increment_counter ? lane : 0);
+        lo[lane] = counter_low(c);
+        hi[lane] = counter_high(c);
+    }
+    const __m512i counter_lo = _mm512_load_si512(lo);
+    const __m512i counter_hi = _mm512_load_si512(hi);
+
+    uint8_t block_flags = flags | flags_start;
+    for (size_t b = 0; b < blocks; ++b) {
+        if (b + 1 == blocks) {
+            block_flags |= flags_end;
+        }
+        __m512i m[16];
+        for (size_t lane = 0; lane < 16; ++lane) {
+            m[lane] = _mm512_loadu_si512(inputs[lane] + b * BLOCK_LEN);
+        }
+        transpose(m);
+
+        __m512i v[16] = {
+            h[0],        h[1],        h[2],        h[3],       h[4],       h[5],
+            h[6],        h[7],        set1(IV[0]), set1(IV[1]), set1(IV[2]), set1(IV[3]),
+            counter_lo,  counter_hi,  set1(BLOCK_LEN), set1(block_flags),
+        };
+        for (size_t r = 0; r < 7; ++r) {
+            round_fn16(v, m, r);
+        }
+        for (size_t i = 0; i < 8; ++i) {
+            h[i] = xorv(v[i], v[i + 8]);
+        }
+        block_flags = flags;
+    }
+
+    for (size_t i = 8; i < 16; ++i) {
+        h[i] = _mm512_setzero_si512();
+    }
+    transpose(h);
+    for (size_t lane = 0; lane < 16; ++lane) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + lane * OUT_LEN), _mm512_castsi512_si256(h[lane]));
+    }
+}
+
+} // namespace
+
+AVX512 void compress_in_place_avx512(
+    uint32_t cv[8], const uint8_t block[BLOCK_LEN], uint8_t block_len, uint64_t counter, uint8_t flags)
+{
+    __m128i row0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&cv[0]));
+    __m128i row1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&cv[4]));
+    __m128i row2 = set4(IV[0], IV[1], IV[2], IV[3]);
+    __m128i row3 = set4(counter_low(counter), counter_high(counter), block_len, flags);
+
+    uint32_t m[16];
+    for (size_t i = 0; i < 16; ++i) {
+        m[i] = load32(block + 4 * i);
+    }
+
+    // Same row-wise layout as the SSE4.1 kernel, with single-instruction rotates.
+    for (const auto& s : MSG_SCHEDULE) {
+        g1(row0, row1, row2, row3, set4(m[s[0]], m[s[2]], m[s[4]], m[s[6]]));
+        g2(row0, row1, row2, row3, set4(m[s[1]], m[s[3]], m[s[5]], m[s[7]]));
+        row0 = _mm_shuffle_epi32(row0, _MM_SHUFFLE(2, 1, 0, 3));
+        row3 = _mm_shuffle_epi32(row3, _MM_SHUFFLE(1, 0, 3, 2));
+        row2 = _mm_shuffle_epi32(row2, _MM_SHUFFLE(0, 3, 2, 1));
+        g1(row0, row1, row2, row3, set4(m[s[14]], m[s[8]], m[s[10]], m[s[12]]));
+        g2(row0, row1, row2, row3, set4(m[s[15]], m[s[9]], m[s[11]], m[s[13]]));
+        row0 = _mm_shuffle_epi32(row0, _MM_SHUFFLE(0, 3, 2, 1));
+        row3 = _mm_shuffle_epi32(row3, _MM_SHUFFLE(1, 0, 3, 2));
+        row2 = _mm_shuffle_epi32(row2, _MM_SHUFFLE(2, 1, 0, 3));
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&cv[0]), _mm_xor_si128(row0, row2));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&cv[4]), _mm_xor_si128(row1, row3));
+}
+
+AVX512 void hash_many_avx512(const uint8_t* const* inputs,
+                             size_t num_inputs,
+                             size_t blocks,
+                             const uint32_t key[8],
+                             uint64_t counter,
+                             bool increment_counter,
+                             uint8_t flags,
+                             uint8_t flags_start,
+                             uint8_t flags_end,
+                             uint8_t* out)
+{
+    while (num_inputs >= 16) {
+        hash16(inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+        if (increment_counter) {
+            counter += 16;
+        }
+        inputs += 16;
+        num_inputs -= 16;
+        out += 16 * OUT_LEN;
+    }
+    hash_many_avx2(inputs, num_inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+}
+
+#undef AVX512
+
+} // namespace blake3::detail
+
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "blake3.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using blake3_hash_t = std::array<uint8_t, 32>;
+
+/**
+ * Interface:
+ *  - compress(lhs, rhs): concatenates lhs and rhs (64 bytes total) and returns their 32-byte BLAKE3 hash.
+ *  - hash(data): returns a 32-byte BLAKE3 hash of arbitrary-length data.
+ *
+ * Not circuit friendly; meant for trees that never need to be opened inside a proof.
+ */
+class Blake3Hasher {
+  public:
+    using hash_t = blake3_hash_t;
+
+    /**
+     * Given two 32-byte buffers, return a 32-byte digest representing their concatenation.
+     */
+    std::array<uint8_t, 32> compress(const blake3_hash_t& lhs, const blake3_hash_t& rhs)
+    {
+        // 64 bytes is exactly one block of a single-chunk input, so this is one compression call.
+        uint8_t block[blake3::BLOCK_LEN];
+        std::memcpy(block, lhs.data(), 32);
+        std::memcpy(block + 32, rhs.data(), 32);
+        return hash_block(block, blake3::BLOCK_LEN);
+    }
+
+    /**
+     * Given data of arbitrary length, return its 32-byte BLAKE3 hash.
+     */
+    std::array<uint8_t, 32> hash(const std::vector<uint8_t>& data)
+    {
+        if (data.size() <= blake3::BLOCK_LEN) {
+            uint8_t block[blake3::BLOCK_LEN] = {};
+            std::memcpy(block, data.data(), data.size());
+            return hash_block(block, static_cast<uint8_t>(data.size()));
+        }
+        BLAKE3 b3;
+        b3.update(data.data(), data.size());
+        return b3.digest();
+    }
+
+    /**
+     * Compress `count` (lhs, rhs) pairs stored back to back in `nodes` (2 * count hashes) into `out`.
+     * Pairs are hashed side by side in SIMD lanes.
+     */
+    void compress_many(const blake3_hash_t* nodes, size_t count, blake3_hash_t* out)
+    {
+        constexpr size_t batch = 64;
+        const uint8_t* inputs[batch];
+        for (size_t i = 0; i < count; i += batch) {
+            const size_t n = std::min(batch, count - i);
+            for (size_t j = 0; j < n; ++j) {
+                inputs[j] = nodes[2 * (i + j)].data();
+            }
+            blake3::hash_many(inputs,
+                              n,
+                              1,
+                              blake3::IV.data(),
+                              0,
+                              false,
+                              0,
+                              blake3::CHUNK_START | blake3::CHUNK_END | blake3::ROOT,
+                              0,
+                              out[i].data());
+        }
+    }
+
+  private:
+    static blake3_hash_t hash_block(const uint8_t block[blake3::BLOCK_LEN], uint8_t block_len)
+    {
+        uint32_t cv[8];
+        std::memcpy(cv, blake3::IV.data(), sizeof(cv));
+        blake3::compress_in_place(cv, block, block_len, 0, blake3::CHUNK_START | blake3::CHUNK_END | blake3::ROOT);
+        blake3_hash_t out;
+        for (size_t i = 0; i < 8; ++i) {
+            out[4 * i] = static_cast<uint8_t>(cv[i]);
+            out[4 * i + 1] = static_cast<uint8_t>(cv[i] >> 8);
+            out[4 * i + 2] = static_cast<uint8_t>(cv[i] >> 16);
+            out[4 * i + 3] = static_cast<uint8_t>(cv[i] >> 24);
+        }
+        return out;
+    }
+};
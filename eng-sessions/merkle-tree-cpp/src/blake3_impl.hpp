@@ -0,0 +1,127 @@
+#pragma once
+#include "blake3.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Internals shared between the portable BLAKE3 code and the SIMD kernels. Not part of the public interface.
+ */
+namespace blake3::detail {
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BLAKE3_X86 1
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BLAKE3_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BLAKE3_TARGET(isa)
+#endif
+
+/**
+ * Message word order for each of the 7 rounds: round r + 1 applies MSG_PERMUTATION to round r.
+ */
+constexpr std::array<std::array<uint8_t, 16>, 7> MSG_SCHEDULE = [] {
+    constexpr std::array<uint8_t, 16> MSG_PERMUTATION = { 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 };
+    std::array<std::array<uint8_t, 16>, 7> schedule{};
+    for (uint8_t i = 0; i < 16; ++i) {
+        schedule[0][i] = i;
+    }
+    for (size_t r = 1; r < 7; ++r) {
+        for (size_t i = 0; i < 16; ++i) {
+            schedule[r][i] = schedule[r - 1][MSG_PERMUTATION[i]];
+        }
+    }
+    return schedule;
+}();
+
+inline uint32_t load32(const uint8_t* src)
+{
+    return static_cast<uint32_t>(src[0]) | (static_cast<uint32_t>(src[1]) << 8) |
+           (static_cast<uint32_t>(src[2]) << 16) | (static_cast<uint32_t>(src[3]) << 24);
+}
+
+inline void store32(uint8_t* dst, uint32_t w)
+{
+    dst[0] = static_cast<uint8_t>(w);
+    dst[1] = static_cast<uint8_t>(w >> 8);
+    dst[2] = static_cast<uint8_t>(w >> 16);
+    dst[3] = static_cast<uint8_t>(w >> 24);
+}
+
+inline void store_cv_words(uint8_t bytes_out[32], const uint32_t cv_words[8])
+{
+    for (size_t i = 0; i < 8; ++i) {
+        store32(&bytes_out[i * 4], cv_words[i]);
+    }
+}
+
+inline uint32_t counter_low(uint64_t counter)
+{
+    return static_cast<uint32_t>(counter);
+}
+
+inline uint32_t counter_high(uint64_t counter)
+{
+    return static_cast<uint32_t>(counter >> 32);
+}
+
+// Portable kernels.
+void compress_in_place_portable(
+    uint32_t cv[8], const uint8_t block[BLOCK_LEN], uint8_t block_len, uint64_t counter, uint8_t flags);
+void hash_many_portable(const uint8_t* const* inputs,
+                        size_t num_inputs,
+                        size_t blocks,
+                        const uint32_t key[8],
+                        uint64_t counter,
+                        bool increment_counter,
+                        uint8_t flags,
+                        uint8_t flags_start,
+                        uint8_t flags_end,
+                        uint8_t* out);
+
+#ifdef BLAKE3_X86
+// SSE4.1: single-block compression in rows, 4-way hash_many.
+void compress_in_place_sse41(
+    uint32_t cv[8], const uint8_t block[BLOCK_LEN], uint8_t block_len, uint64_t counter, uint8_t flags);
+void hash_many_sse41(const uint8_t* const* inputs,
+                     size_t num_inputs,
+                     size_t blocks,
+                     const uint32_t key[8],
+                     uint64_t counter,
+                     bool increment_counter,
+                     uint8_t flags,
+                     uint8_t flags_start,
+                     uint8_t flags_end,
+                     uint8_t* out);
+
+// AVX2: 8-way hash_many. Leftover inputs fall through to the SSE4.1 kernel.
+void hash_many_avx2(const uint8_t* const* inputs,
+                    size_t num_inputs,
+                    size_t blocks,
+                    const uint32_t key[8],
+                    uint64_t counter,
+                    bool increment_counter,
+                    uint8_t flags,
+                    uint8_t flags_start,
+                    uint8_t flags_end,
+                    uint8_t* out);
+
+// AVX-512F/VL: single-block compression using native rotates, 16-way hash_many.
+void compress_in_place_avx512(
+    uint32_t cv[8], const uint8_t block[BLOCK_LEN], uint8_t block_len, uint64_t counter, uint8_t flags);
+void hash_many_avx512(const uint8_t* const* inputs,
+                      size_t num_inputs,
+                      size_t blocks,
+                      const uint32_t key[8],
+                      uint64_t counter,
+                      bool increment_counter,
+                      uint8_t flags,
+                      uint8_t flags_start,
+                      uint8_t flags_end,
+                      uint8_t* out);
+#endif
+
+} // namespace blake3::detail
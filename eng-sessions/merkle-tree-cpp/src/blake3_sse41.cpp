@@ -0,0 +1,245 @@
+#include "blake3_impl.hpp"
+
+#ifdef BLAKE3_X86
+#include <immintrin.h>
+
+namespace blake3::detail {
+
+namespace {
+
+#define SSE41 BLAKE3_TARGET("sse4.1")
+
+SSE41 inline __m128i add(__m128i a, __m128i b)
+{
+    return _mm_add_epi32(a, b);
+}
+
+SSE41 inline __m128i xorv(__m128i a, __m128i b)
+{
+    return _mm_xor_si128(a, b);
+}
+
+SSE41 inline __m128i set1(uint32_t x)
+{
+    return _mm_set1_epi32(static_cast<int32_t>(x));
+}
+
+SSE41 inline __m128i set4(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    return _mm_setr_epi32(
+        static_cast<int32_t>(a), static_cast<int32_t>(b), static_cast<int32_t>(c), static_cast<int32_t>(d));
+}
+
+SSE41 inline __m128i rot16(__m128i x)
+{
+    return _mm_shuffle_epi8(x, _mm_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2));
+}
+
+SSE41 inline __m128i rot12(__m128i x)
+{
+    return _mm_or_si128(_mm_srli_epi32(x, 12), _mm_slli_epi32(x, 32 - 12));
+}
+
+SSE41 inline __m128i rot8(__m128i x)
+{
+    return _mm_shuffle_epi8(x, _mm_set_epi8(12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1));
+}
+
+SSE41 inline __m128i rot7(__m128i x)
+{
+    return _mm_or_si128(_mm_srli_epi32(x, 7), _mm_slli_epi32(x, 32 - 7));
+}
+
+SSE41 inline __m128i loadu(const uint8_t* src)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+}
+
+SSE41 inline void storeu(__m128i x, uint8_t* dst)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), x);
+}
+
+/**
+ * Half of a G function applied to all four columns (or diagonals) at once, one row per register.
+ */
+SSE41 inline void g1(__m128i& row0, __m128i& row1, __m128i& row2, __m128i& row3, __m128i m)
+{
+    row0 = add(add(row0, m), row1);
+    row3 = rot16(xorv(row3, row0));
+    row2 = add(row2, row3);
+    row1 = rot12(xorv(row1, row2));
+}
+
+SSE41 inline void g2(__m128i& row0, __m128i& row1, __m128i& row2, __m128i& row3, __m128i m)
+{
+    row0 = add(add(row0, m), row1);
+    row3 = rot8(xorv(row3, row0));
+    row2 = add(row2, row3);
+    row1 = rot7(xorv(row1, row2));
+}
+
+// Rotate rows 0, 2 and 3 so that the diagonals line up in columns. Row 1 stays put, so lane k of the diagonal step
+// holds G_{(k + 3) % 4}.
+SSE41 inline void diagonalize(__m128i& row0, __m128i& row2, __m128i& row3)
+{
+    row0 = _mm_shuffle_epi32(row0, _MM_SHUFFLE(2, 1, 0, 3));
+    row3 = _mm_shuffle_epi32(row3, _MM_SHUFFLE(1, 0, 3, 2));
+    row2 = _mm_shuffle_epi32(row2, _MM_SHUFFLE(0, 3, 2, 1));
+}
+
+SSE41 inline void undiagonalize(__m128i& row0, __m128i& row2, __m128i& row3)
+{
+    row0 = _mm_shuffle_epi32(row0, _MM_SHUFFLE(0, 3, 2, 1));
+    row3 = _mm_shuffle_epi32(row3, _MM_SHUFFLE(1, 0, 3, 2));
+    row2 = _mm_shuffle_epi32(row2, _MM_SHUFFLE(2, 1, 0, 3));
+}
+
+SSE41 inline void transpose(__m128i v[4])
+{
+    const __m128i ab_01 = _mm_unpacklo_epi32(v[0], v[1]);
+    const __m128i ab_23 = _mm_unpackhi_epi32(v[0], v[1]);
+    const __m128i cd_01 = _mm_unpacklo_epi32(v[2], v[3]);
+    const __m128i cd_23 = _mm_unpackhi_epi32(v[2], v[3]);
+    v[0] = _mm_unpacklo_epi64(ab_01, cd_01);
+    v[1] = _mm_unpackhi_epi64(ab_01, cd_01);
+    v[2] = _mm_unpacklo_epi64(ab_23, cd_23);
+    v[3] = _mm_unpackhi_epi64(ab_23, cd_23);
+}
+
+SSE41 inline void round_fn4(__m128i v[16], const __m128i m[16], size_t r)
+{
+    const auto& s = MSG_SCHEDULE[r];
+    for (size_t i = 0; i < 4; ++i) {
+        g1(v[i], v[i + 4], v[i + 8], v[i + 12], m[s[2 * i]]);
+        g2(v[i], v[i + 4], v[i + 8], v[i + 12], m[s[2 * i + 1]]);
+    }
+    g1(v[0], v[5], v[10], v[15], m[s[8]]);
+    g2(v[0], v[5], v[10], v[15], m[s[9]]);
+    g1(v[1], v[6], v[11], v[12], m[s[10]]);
+    g2(v[1], v[6], v[11], v[12], m[s[11]]);
+    g1(v[2], v[7], v[8], v[13], m[s[12]]);
+    g2(v[2], v[7], v[8], v[13], m[s[13]]);
+    g1(v[3], v[4], v[9], v[14], m[s[14]]);
+    g2(v[3], v[4], v[9], v[14], m[s[15]]);
+}
+
+/**
+ * Hash exactly four inputs, each word of the state holding that word for all four inputs.
+ */
+SSE41 void hash4(const uint8_t* const* inputs,
+                 size_t blocks,
+                 const uint32_t key[8],
+                 uint64_t counter,
+                 bool increment_counter,
+                 uint8_t flags,
+                 uint8_t flags_start,
+                 uint8_t flags_end,
+                 uint8_t* out)
+{
+    __m128i h[8];
+    for (size_t i = 0; i < 8; ++i) {
+        h[i] = set1(key[i]);
+    }
+    uint32_t lo[4];
+    uint32_t hi[4];
+    for (size_t lane = 0; lane < 4; ++lane) {
+        const uint64_t c = counter + (increment_counter ? lane : 0);
+        lo[lane] = counter_low(c);
+        hi[lane] = counter_high(c);
+    }
+    const __m128i counter_lo = set4(lo[0], lo[1], lo[2], lo[3]);
+    const __m128i counter_hi = set4(hi[0], hi[1], hi[2], hi[3]);
+
+    uint8_t block_flags = flags | flags_start;
+    for (size_t b = 0; b < blocks; ++b) {
+        if (b + 1 == blocks) {
+            block_flags |= flags_end;
+        }
+        __m128i m[16];
+        for (size_t quad = 0; quad < 4; ++quad) {
+            for (size_t lane = 0; lane < 4; ++lane) {
+                m[4 * quad + lane] = loadu(inputs[lane] + b * BLOCK_LEN + 16 * quad);
+            }
+            transpose(&m[4 * quad]);
+        }
+
+        __m128i v[16] = {
+            h[0],        h[1],        h[2],        h[3],       h[4],       h[5],
+            h[6],        h[7],        set1(IV[0]), set1(IV[1]), set1(IV[2]), set1(IV[3]),
+            counter_lo,  counter_hi,  set1(BLOCK_LEN), set1(block_flags),
+        };
+        for (size_t r = 0; r < 7; ++r) {
+            round_fn4(v, m, r);
+        }
+        for (size_t i = 0; i < 8; ++i) {
+            h[i] = xorv(v[i], v[i + 8]);
+        }
+        block_flags = flags;
+    }
+
+    transpose(&h[0]);
+    transpose(&h[4]);
+    for (size_t lane = 0; lane < 4; ++lane) {
+        storeu(h[lane], out + lane * OUT_LEN);
+        storeu(h[lane + 4], out + lane * OUT_LEN + 16);
+    }
+}
+
+} // namespace
+
+SSE41 void compress_in_place_sse41(
+    uint32_t cv[8], const uint8_t block[BLOCK_LEN], uint8_t block_len, uint64_t counter, uint8_t flags)
+{
+    __m128i row0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&cv[0]));
+    __m128i row1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&cv[4]));
+    __m128i row2 = set4(IV[0], IV[1], IV[2], IV[3]);
+    __m128i row3 = set4(counter_low(counter), counter_high(counter), block_len, flags);
+
+    uint32_t m[16];
+    for (size_t i = 0; i < 16; ++i) {
+        m[i] = load32(block + 4 * i);
+    }
+
+    for (const auto& s : MSG_SCHEDULE) {
+        g1(row0, row1, row2, row3, set4(m[s[0]], m[s[2]], m[s[4]], m[s[6]]));
+        g2(row0, row1, row2, row3, set4(m[s[1]], m[s[3]], m[s[5]], m[s[7]]));
+        diagonalize(row0, row2, row3);
+        g1(row0, row1, row2, row3, set4(m[s[14]], m[s[8]], m[s[10]], m[s[12]]));
+        g2(row0, row1, row2, row3, set4(m[s[15]], m[s[9]], m[s[11]], m[s[13]]));
+        undiagonalize(row0, row2, row3);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&cv[0]), xorv(row0, row2));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&cv[4]), xorv(row1, row3));
+}
+
+SSE41 void hash_many_sse41(const uint8_t* const* inputs,
+                           size_t num_inputs,
+                           size_t blocks,
+                           const uint32_t key[8],
+                           uint64_t counter,
+                           bool increment_counter,
+                           uint8_t flags,
+                           uint8_t flags_start,
+                           uint8_t flags_end,
+                           uint8_t* out)
+{
+    while (num_inputs >= 4) {
+        hash4(inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+        if (increment_counter) {
+            counter += 4;
+        }
+        inputs += 4;
+        num_inputs -= 4;
+        out += 4 * OUT_LEN;
+    }
+    hash_many_portable(
+        inputs, num_inputs, blocks, key, counter, increment_counter, flags, flags_start, flags_end, out);
+}
+
+#undef SSE41
+
+} // namespace blake3::detail
+
+#endif
@@ -1,24 +1,30 @@
 #pragma once
 
+#include "hasher.hpp"
 #include "sha256_hasher.hpp"
-#include <vector>
+#include <array>
 #include <cstdint>
+#include <tuple>
 #include <utility>
+#include <vector>
 
 /**
  * Mimics the TypeScript HashPath class.
  * A HashPath is a collection of pairs of 32-byte hashes, each pair
  * representing the left/right child at a given layer in the Merkle path.
  */
-class HashPath {
+template <Hasher HasherT> class BasicHashPath {
 public:
+    using hash_t = typename HasherT::hash_t;
+    static constexpr size_t HASH_BYTES = std::tuple_size_v<hash_t>;
+
     // Each entry in 'data' is (left_node, right_node).
-    // Each node is 32 bytes. We'll store them in a sha256_hash_t of length 32.
-    std::vector<std::pair<sha256_hash_t, sha256_hash_t>> data;
+    // Each node is 32 bytes. We'll store them in a hash_t of length 32.
+    std::vector<std::pair<hash_t, hash_t>> data;
 
-    HashPath() = default;
+    BasicHashPath() = default;
 
-    HashPath(const std::vector<std::pair<sha256_hash_t, sha256_hash_t>> &d)
+    BasicHashPath(const std::vector<std::pair<hash_t, hash_t>> &d)
         : data(d) {
     }
 
@@ -30,7 +36,7 @@ public:
     std::vector<uint8_t> to_buffer() const
     {
         std::vector<uint8_t> buf;
-        buf.reserve(data.size() * 64);
+        buf.reserve(data.size() * 2 * HASH_BYTES);
         for (const auto &pair_item : data) {
             buf.insert(buf.end(), pair_item.first.begin(), pair_item.first.end());
             buf.insert(buf.end(), pair_item.second.begin(), pair_item.second.end());
@@ -42,20 +48,21 @@ public:
      * Construct a HashPath from a buffer created by 'to_buffer()'.
      * For each 64 bytes, the first 32 are left, the second 32 are right.
      */
-    static HashPath from_buffer(const std::vector<uint8_t>& buf)
+    static BasicHashPath from_buffer(const std::vector<uint8_t>& buf)
     {
-        HashPath path;
-        if (buf.size() % 64 != 0) {
+        BasicHashPath path;
+        if (buf.size() % (2 * HASH_BYTES) != 0) {
             // Invalid. In real usage, might throw or handle differently.
             return path;
         }
-        size_t count = buf.size() / 64;
+        size_t count = buf.size() / (2 * HASH_BYTES);
         path.data.reserve(count);
         for (size_t i = 0; i < count; ++i) {
-            std::array<uint8_t, 32> left;
-            std::array<uint8_t, 32> right;
-            std::copy(buf.begin() + i * 64, buf.begin() + i * 64 + 32, left.begin());
-            std::copy(buf.begin() + i * 64 + 32, buf.begin() + i * 64 + 64, right.begin());
+            hash_t left;
+            hash_t right;
+            auto pair_begin = buf.begin() + static_cast<std::ptrdiff_t>(i * 2 * HASH_BYTES);
+            std::copy(pair_begin, pair_begin + HASH_BYTES, left.begin());
+            std::copy(pair_begin + HASH_BYTES, pair_begin + 2 * HASH_BYTES, right.begin());
             path.data.emplace_back(std::make_pair(left, right));
         }
         return path;
@@ -65,7 +72,8 @@ public:
 /**
  * Simple equality operator for testing or comparison.
  */
-inline bool operator==(const HashPath &a, const HashPath &b) {
+template <Hasher HasherT>
+inline bool operator==(const BasicHashPath<HasherT> &a, const BasicHashPath<HasherT> &b) {
     if (a.data.size() != b.data.size()) {
         return false;
     }
@@ -77,3 +85,5 @@ inline bool operator==(const HashPath &a, const HashPath &b) {
     }
     return true;
 }
+
+using HashPath = BasicHashPath<Sha256Hasher>;
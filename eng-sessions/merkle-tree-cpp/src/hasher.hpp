@@ -0,0 +1,22 @@
+#pragma once
+
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <vector>
+
+/**
+ * What MerkleTree and HashPath need from a hash function. Both are class templates over the hasher, so calls to
+ * `compress` and `hash` are resolved (and can be inlined) at compile time.
+ *
+ *  - compress(lhs, rhs): 32-byte digest of the 64-byte concatenation of two node hashes.
+ *  - hash(data): 32-byte digest of arbitrary-length data.
+ *
+ * Node hashes are fixed at 32 bytes because that is what the key-value store holds.
+ */
+template <typename T>
+concept Hasher = requires(T hasher, const typename T::hash_t& node, const std::vector<uint8_t>& data) {
+    requires std::same_as<typename T::hash_t, std::array<uint8_t, 32>>;
+    { hasher.compress(node, node) } -> std::same_as<typename T::hash_t>;
+    { hasher.hash(data) } -> std::same_as<typename T::hash_t>;
+};
@@ -7,9 +7,12 @@
 #include <stdexcept>
 #include <vector>
 
+#include "blake3_hasher.hpp"
 #include "hash_path.hpp"
 #include "merkle_tree.hpp"
 #include "mock_db.hpp"
+#include "proof_protocol.hpp"
+#include "proof_service.hpp"
 #include "sha256_hasher.hpp"
 
 /**
@@ -225,6 +228,169 @@ void run_tests()
         std::cout << "Test 4 success" << std::endl;
     }
 
+    // Test 5: The same tree over BLAKE3, and every BLAKE3 SIMD backend against the portable code.
+    {
+        std::cout << "Test 5: Verify the BLAKE3 hasher and a BLAKE3 tree of depth 2." << std::endl;
+        MockDB db;
+        Blake3Hasher hasher;
+
+        assert_equal_hex(hasher.hash({}),
+                         "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262",
+                         "BLAKE3 of the empty input");
+        assert_equal_hex(hasher.hash({ 'a', 'b', 'c' }),
+                         "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85",
+                         "BLAKE3 of 'abc'");
+
+        // Multi-chunk inputs take the hash_many path; they must agree with byte-at-a-time updates.
+        std::vector<uint8_t> long_input(31744);
+        for (size_t i = 0; i < long_input.size(); ++i) {
+            long_input[i] = static_cast<uint8_t>(i % 251);
+        }
+        BLAKE3 incremental;
+        for (uint8_t byte : long_input) {
+            incremental.update(&byte, 1);
+        }
+        assert_equal_hex(hasher.hash(long_input),
+                         "62b6960e1a44bcc1eb1a611a8d6235b6b4b78f32e7abc4fb4c6cdcce94895c47",
+                         "BLAKE3 of a 31 chunk input");
+        assert_equal_hex(incremental.digest(), to_hex(hasher.hash(long_input)), "Incremental BLAKE3");
+
+        std::vector<blake3_hash_t> nodes(2 * 37);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            nodes[i] = hasher.hash(values[i]);
+        }
+        std::vector<const uint8_t*> inputs;
+        for (size_t i = 0; i < 37; ++i) {
+            inputs.push_back(nodes[2 * i].data());
+        }
+        std::vector<blake3_hash_t> expected(37);
+        std::vector<blake3_hash_t> actual(37);
+        for (size_t i = 0; i < 37; ++i) {
+            expected[i] = hasher.compress(nodes[2 * i], nodes[2 * i + 1]);
+        }
+        const auto detected = blake3::detect_backend();
+        for (auto backend : {
+                 blake3::backend::portable, blake3::backend::sse41, blake3::backend::avx2, blake3::backend::avx512 }) {
+            if (blake3::simd_degree(backend) > blake3::simd_degree(detected)) {
+                continue;
+            }
+            blake3::hash_many(backend,
+                              inputs.data(),
+                              inputs.size(),
+                              1,
+                              blake3::IV.data(),
+                              0,
+                              false,
+                              0,
+                              blake3::CHUNK_START | blake3::CHUNK_END | blake3::ROOT,
+                              0,
+                              actual[0].data());
+            if (actual != expected) {
+                throw std::runtime_error("BLAKE3 hash_many disagrees with single compressions.");
+            }
+        }
+
+        blake3_hash_t e00 = hasher.hash(values[0]);
+        blake3_hash_t e01 = hasher.hash(values[1]);
+        blake3_hash_t e02 = hasher.hash(values[2]);
+        blake3_hash_t e03 = hasher.hash(values[3]);
+        blake3_hash_t e10 = hasher.compress(e00, e01);
+        blake3_hash_t e11 = hasher.compress(e02, e03);
+
+        auto tree = BasicMerkleTree<Blake3Hasher>::create(db, "blake3", 2);
+        for (int i = 0; i < 4; ++i) {
+            tree.update_element(i, values[i]);
+        }
+        if (!(tree.get_hash_path(2) == BasicHashPath<Blake3Hasher>({ { e02, e03 }, { e10, e11 } }))) {
+            throw std::runtime_error("BLAKE3 hash path for index 2 does not match expected value.");
+        }
+        assert_equal_hex(tree.get_root(), to_hex(hasher.compress(e10, e11)), "BLAKE3 depth=2 root check");
+
+        std::cout << "Test 5 success" << std::endl;
+    }
+
+    // Test 6: Batched reads and updates agree with the one-at-a-time API, including through the proof service.
+    {
+        std::cout << "Test 6: Verify batched hash paths and updates, and the proof service framing." << std::endl;
+        MockDB db;
+        auto single = MerkleTree::create(db, "single", 10);
+        auto batched = MerkleTree::create(db, "batched", 10);
+
+        std::vector<std::pair<uint64_t, std::vector<uint8_t>>> updates;
+        for (uint64_t i = 0; i < 300; ++i) {
+            // Repeated and adjacent indices; the last write to an index must win.
+            const uint64_t index = (i * 37) % 257;
+            updates.emplace_back(index, values[i % values.size()]);
+            single.update_element(index, values[i % values.size()]);
+        }
+        assert_equal_hex(batched.update_elements(updates), to_hex(single.get_root()), "Batched update root");
+
+        const std::vector<uint64_t> indices = { 0, 1, 256, 1023, 5, 5 };
+        const auto paths = batched.get_hash_paths(indices);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            if (!(paths[i] == single.get_hash_path(indices[i]))) {
+                throw std::runtime_error("Batched hash path does not match single hash path.");
+            }
+        }
+
+        // One pipelined batch: update, read back, an out-of-range read, then the root.
+        using namespace proof_service;
+        auto served = BasicMerkleTree<Blake3Hasher>::create(db, "served", 4);
+        ProofService<Blake3Hasher> service(served);
+        std::vector<uint8_t> wire;
+        request update{ 1, opcode::UPDATE, 3, {} };
+        update.value.fill(0xab);
+        encode_request(update, wire);
+        encode_request({ 2, opcode::GET_HASH_PATH, 3, {} }, wire);
+        encode_request({ 3, opcode::GET_HASH_PATH, 16, {} }, wire);
+        encode_request({ 4, opcode::GET_ROOT, 0, {} }, wire);
+        wire.push_back(0); // start of a partial frame
+
+        std::vector<request> batch;
+        if (decode_requests(wire.data(), wire.size(), batch) != wire.size() - 1 || batch.size() != 4) {
+            throw std::runtime_error("Request framing round trip failed.");
+        }
+        const auto responses = service.handle(batch);
+        const auto root = served.get_root();
+        const auto path = served.get_hash_path(3);
+        if (responses[0].payload != std::vector<uint8_t>(root.begin(), root.end()) ||
+            responses[3].payload != responses[0].payload || responses[2].st != status::ERROR ||
+            responses[1].payload.size() != 4 * 64 ||
+            !std::equal(path.data[0].second.begin(), path.data[0].second.end(), responses[1].payload.begin() + 32)) {
+            throw std::runtime_error("Proof service responses do not match the tree.");
+        }
+        if (service.get_stats().update_batches != 1 || service.get_stats().read_batches != 1) {
+            throw std::runtime_error("Proof service did not coalesce the batch.");
+        }
+
+        // Interleaved reads and updates are served run by run, in order: the leading read sees the tree from before
+        // the updates after it, and the read between the updates sees only the first.
+        request first{ 5, opcode::UPDATE, 7, {} };
+        request second{ 7, opcode::UPDATE, 7, {} };
+        first.value.fill(0x01);
+        second.value.fill(0x02);
+        const auto interleaved =
+            service.handle({ { 6, opcode::GET_ROOT, 0, {} }, first, { 8, opcode::GET_HASH_PATH, 7, {} }, second });
+        served.update_element(7, std::vector<uint8_t>(first.value.begin(), first.value.end()));
+        const auto first_root = served.get_root();
+        const auto first_path = served.get_hash_path(7);
+        served.update_element(7, std::vector<uint8_t>(second.value.begin(), second.value.end()));
+        const auto second_root = served.get_root();
+        if (interleaved[0].payload != responses[3].payload ||
+            interleaved[1].payload != std::vector<uint8_t>(first_root.begin(), first_root.end()) ||
+            !std::equal(first_path.data[0].second.begin(),
+                        first_path.data[0].second.end(),
+                        interleaved[2].payload.begin() + 32) ||
+            interleaved[3].payload != std::vector<uint8_t>(second_root.begin(), second_root.end())) {
+            throw std::runtime_error("Proof service did not serve an interleaved batch in order.");
+        }
+        if (service.get_stats().update_batches != 3 || service.get_stats().read_batches != 3) {
+            throw std::runtime_error("Proof service did not coalesce an interleaved batch run by run.");
+        }
+
+        std::cout << "Test 6 success" << std::endl;
+    }
+
     std::cout << "All tests passed successfully!\n";
 }
 
@@ -1,25 +1,37 @@
 #pragma once
 
 #include "hash_path.hpp"
+#include "hasher.hpp"
 #include "mock_db.hpp"
 #include "sha256_hasher.hpp"
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 /**
- * The MerkleTree class implements a Merkle tree—a data structure that enables efficient
+ * The BasicMerkleTree class implements a Merkle tree—a data structure that enables efficient
  * proofs of membership.
  *
- * NOTE: This is a placeholder version. All helper methods and internal implementation details
- * have been removed. Replace the "// Implement" comments with the appropriate logic.
+ * The tree is a class template over its Hasher, so the node hashing in the update and path loops is bound at
+ * compile time. `MerkleTree` is the SHA-256 instantiation.
+ *
+ * Layer 0 is the root and leaves live at layer `depth`. Only nodes that have been written are kept in the
+ * database; any other node is the root of an empty subtree and is served from `zero_hashes`.
  */
-class MerkleTree {
+template <Hasher HasherT> class BasicMerkleTree {
   private:
     static constexpr uint32_t MAX_DEPTH = 32;
     static constexpr uint32_t LEAF_BYTES = 64;
+
   public:
+    using hash_t = typename HasherT::hash_t;
+    using hash_path_t = BasicHashPath<HasherT>;
+
     /**
      * Constructs a new or existing tree.
      *
@@ -30,7 +42,7 @@ class MerkleTree {
      *
      * Throws std::runtime_error if depth is not in [1, 32].
      */
-    MerkleTree(MockDB& db, const std::string& name, uint32_t depth, const sha256_hash_t& root = {})
+    BasicMerkleTree(MockDB& db, const std::string& name, uint32_t depth, const hash_t& root = {})
         : db(db)
         , name(name)
         , depth(depth)
@@ -40,7 +52,18 @@ class MerkleTree {
         if (!(depth >= 1 && depth <= MAX_DEPTH)) {
             throw std::runtime_error("Bad depth");
         }
-        // Implement.
+
+        // zero_hashes[layer] is the root of an empty subtree whose top is at `layer`.
+        zero_hashes.resize(depth + 1);
+        zero_hashes[depth] = hasher.hash(std::vector<uint8_t>(LEAF_BYTES, 0));
+        for (uint32_t layer = depth; layer > 0; --layer) {
+            zero_hashes[layer - 1] = hasher.compress(zero_hashes[layer], zero_hashes[layer]);
+        }
+
+        if (root == hash_t{}) {
+            auto stored_root = db.get(name);
+            this->root = stored_root.has_value() ? *stored_root : zero_hashes[0];
+        }
     }
 
     /**
@@ -51,29 +74,43 @@ class MerkleTree {
      * @param depth The tree’s depth (default is 32).
      * @return A MerkleTree instance.
      */
-    static MerkleTree create(MockDB& db, const std::string& name, uint32_t depth = MAX_DEPTH)
+    static BasicMerkleTree create(MockDB& db, const std::string& name, uint32_t depth = MAX_DEPTH)
     {
-        return MerkleTree(db, name, depth);
+        return BasicMerkleTree(db, name, depth);
     }
 
     /**
      * Returns the current Merkle tree root (32 bytes).
      */
-    sha256_hash_t get_root() const
+    hash_t get_root() const
     {
         return root;
     }
 
+    /**
+     * Returns the tree depth (leaves live at layer = depth).
+     */
+    uint32_t get_depth() const
+    {
+        return depth;
+    }
+
     /**
      * Returns the hash path (Merkle proof) for a particular leaf index.
      *
      * @param index The leaf index.
      * @return A HashPath object.
      */
-    HashPath get_hash_path(uint64_t index) const
+    hash_path_t get_hash_path(uint64_t index) const
     {
-        // Implement.
-        return HashPath();
+        hash_path_t path;
+        path.data.reserve(depth);
+        for (uint32_t layer = depth; layer > 0; --layer) {
+            const uint64_t left = index & ~uint64_t(1);
+            path.data.emplace_back(get_node(layer, left), get_node(layer, left + 1));
+            index >>= 1;
+        }
+        return path;
     }
 
     /**
@@ -85,17 +122,190 @@ class MerkleTree {
      *
      * Throws std::runtime_error if value is not exactly 64 bytes.
      */
-    sha256_hash_t update_element(uint64_t index, const std::vector<uint8_t>& value)
+    hash_t update_element(uint64_t index, const std::vector<uint8_t>& value)
+    {
+        if (value.size() != LEAF_BYTES) {
+            throw std::runtime_error("Leaf value must be 64 bytes");
+        }
+        if (index >= (uint64_t(1) << depth)) {
+            throw std::runtime_error("Leaf index out of range");
+        }
+
+        std::vector<MockDBBatchItem> batch;
+        batch.reserve(depth + 1);
+
+        hash_t current = hasher.hash(value);
+        for (uint32_t layer = depth; layer > 0; --layer) {
+            batch.push_back({ node_key(layer, index), current });
+            const hash_t sibling = get_node(layer, index ^ 1);
+            current = (index & 1) ? hasher.compress(sibling, current) : hasher.compress(current, sibling);
+            index >>= 1;
+        }
+        batch.push_back({ name, current });
+        db.batch_write(batch);
+
+        root = current;
+        return root;
+    }
+
+    /**
+     * Returns the hash paths for several leaf indices at once. Nodes shared between the paths (at the very least
+     * the upper layers) are read from the database only once.
+     *
+     * @param indices The leaf indices, in any order and possibly repeated.
+     * @return One HashPath per index, in the order given.
+     */
+    std::vector<hash_path_t> get_hash_paths(const std::vector<uint64_t>& indices) const
+    {
+        std::unordered_map<uint64_t, hash_t> nodes;
+        const auto cached_node = [&](uint32_t layer, uint64_t index) -> const hash_t& {
+            auto [it, inserted] = nodes.try_emplace((uint64_t(layer) << 32) | index);
+            if (inserted) {
+                it->second = get_node(layer, index);
+            }
+            return it->second;
+        };
+
+        std::vector<hash_path_t> paths(indices.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            uint64_t index = indices[i];
+            paths[i].data.reserve(depth);
+            for (uint32_t layer = depth; layer > 0; --layer) {
+                const uint64_t left = index & ~uint64_t(1);
+                paths[i].data.emplace_back(cached_node(layer, left), cached_node(layer, left + 1));
+                index >>= 1;
+            }
+        }
+        return paths;
+    }
+
+    /**
+     * Applies several leaf updates and recomputes every affected node exactly once, layer by layer. All node
+     * writes go to the database in a single batch. If an index appears more than once the last value wins.
+     *
+     * @param updates (index, 64-byte value) pairs.
+     * @return The new 32-byte tree root.
+     *
+     * Throws std::runtime_error, before anything is written, if any value is not exactly 64 bytes or any index is
+     * out of range.
+     */
+    hash_t update_elements(const std::vector<std::pair<uint64_t, std::vector<uint8_t>>>& updates)
     {
-        // Implement.
+        for (const auto& [index, value] : updates) {
+            if (value.size() != LEAF_BYTES) {
+                throw std::runtime_error("Leaf value must be 64 bytes");
+            }
+            if (index >= (uint64_t(1) << depth)) {
+                throw std::runtime_error("Leaf index out of range");
+            }
+        }
+        if (updates.empty()) {
+            return root;
+        }
+
+        // Dirty nodes of the current layer, sorted by index. stable_sort + keeping the last of each run means the
+        // last update of an index wins.
+        std::vector<std::pair<uint64_t, hash_t>> layer_nodes;
+        layer_nodes.reserve(updates.size());
+        for (const auto& [index, value] : updates) {
+            layer_nodes.emplace_back(index, hasher.hash(value));
+        }
+        std::stable_sort(layer_nodes.begin(), layer_nodes.end(), [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        });
+        layer_nodes.erase(layer_nodes.begin(),
+                          std::unique(layer_nodes.rbegin(),
+                                      layer_nodes.rend(),
+                                      [](const auto& a, const auto& b) { return a.first == b.first; })
+                              .base());
+
+        std::vector<MockDBBatchItem> batch;
+        std::vector<hash_t> pairs;
+        std::vector<hash_t> parents;
+        for (uint32_t layer = depth; layer > 0; --layer) {
+            // Gather (left, right) for every dirty parent; siblings that are not dirty come from the database.
+            pairs.clear();
+            std::vector<std::pair<uint64_t, hash_t>> parent_nodes;
+            for (size_t i = 0; i < layer_nodes.size(); ++i) {
+                const auto& [index, node] = layer_nodes[i];
+                batch.push_back({ node_key(layer, index), node });
+                const bool has_right = (index & 1) == 0 && i + 1 < layer_nodes.size() &&
+                                       layer_nodes[i + 1].first == index + 1;
+                if (has_right) {
+                    pairs.push_back(node);
+                    pairs.push_back(layer_nodes[i + 1].second);
+                    batch.push_back({ node_key(layer, index + 1), layer_nodes[i + 1].second });
+                    ++i;
+                } else if (index & 1) {
+                    pairs.push_back(get_node(layer, index - 1));
+                    pairs.push_back(node);
+                } else {
+                    pairs.push_back(node);
+                    pairs.push_back(get_node(layer, index + 1));
+                }
+                parent_nodes.emplace_back(index >> 1, hash_t{});
+            }
+
+            parents.resize(parent_nodes.size());
+            compress_pairs(pairs.data(), parent_nodes.size(), parents.data());
+            for (size_t i = 0; i < parent_nodes.size(); ++i) {
+                parent_nodes[i].second = parents[i];
+            }
+            layer_nodes = std::move(parent_nodes);
+        }
+
+        root = layer_nodes[0].second;
+        batch.push_back({ name, root });
+        db.batch_write(batch);
         return root;
     }
 
   private:
+    /**
+     * Compress `count` (left, right) pairs laid out back to back. Hashers that can hash several independent inputs
+     * at once (e.g. SIMD lanes) expose `compress_many`; the rest are called one pair at a time.
+     */
+    void compress_pairs(const hash_t* pairs, size_t count, hash_t* out)
+    {
+        if constexpr (requires(HasherT h, const hash_t* in, size_t n, hash_t* o) { h.compress_many(in, n, o); }) {
+            hasher.compress_many(pairs, count, out);
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = hasher.compress(pairs[2 * i], pairs[2 * i + 1]);
+            }
+        }
+    }
+
+    /**
+     * Database key of the node at (layer, index): the tree name, a separator, one byte of layer and eight bytes of
+     * big-endian index. The root itself is stored under the bare tree name.
+     */
+    std::string node_key(uint32_t layer, uint64_t index) const
+    {
+        std::string key;
+        key.reserve(name.size() + 10);
+        key.append(name);
+        key.push_back(':');
+        key.push_back(static_cast<char>(layer));
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            key.push_back(static_cast<char>((index >> shift) & 0xff));
+        }
+        return key;
+    }
+
+    hash_t get_node(uint32_t layer, uint64_t index) const
+    {
+        auto node = db.get(node_key(layer, index));
+        return node.has_value() ? *node : zero_hashes[layer];
+    }
+
     // Core member variables.
     MockDB& db;
     std::string name;
     uint32_t depth;
-    sha256_hash_t root;
-    Sha256Hasher hasher;
+    hash_t root;
+    HasherT hasher;
+    std::vector<hash_t> zero_hashes;
 };
+
+using MerkleTree = BasicMerkleTree<Sha256Hasher>;
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "proof_protocol.hpp"
+#include "proof_socket.hpp"
+
+/**
+ * Load generator for proof_server.
+ *
+ *   proof_loadgen <unix:path | tcp:port> [--connections C] [--pipeline W] [--requests N] [--updates PCT]
+ *                 [--leaves L]
+ *
+ * Opens C connections, each on its own thread, and keeps W requests in flight on each until it has sent N. A request
+ * is an UPDATE with probability PCT% and otherwise a GET_HASH_PATH (one in sixteen reads is a GET_ROOT), at a
+ * uniformly random index below L, which must not exceed the server's 2^depth leaves. Latency is measured from the
+ * moment a request is handed to the kernel until its response has been decoded.
+ */
+
+namespace {
+
+using namespace proof_service;
+using clock_type = std::chrono::steady_clock;
+
+struct options {
+    endpoint ep;
+    size_t connections = 4;
+    size_t pipeline = 32;
+    size_t requests = 100000;
+    unsigned update_percent = 10;
+    uint64_t leaves = 1 << 16;
+};
+
+struct client_result {
+    std::vector<double> latencies_us;
+    size_t errors = 0;
+};
+
+void send_all(int fd, const std::vector<uint8_t>& data)
+{
+    size_t pos = 0;
+    while (pos < data.size()) {
+        const ssize_t n = send(fd, data.data() + pos, data.size() - pos, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw socket_error("send");
+        }
+        pos += static_cast<size_t>(n);
+    }
+}
+
+void run_client(const options& opts, uint64_t seed, client_result& result)
+{
+    const int fd = connect_to(opts.ep);
+    std::mt19937_64 rng(seed);
+    std::vector<clock_type::time_point> sent_at(opts.requests);
+    result.latencies_us.reserve(opts.requests);
+
+    size_t sent = 0;
+    size_t received = 0;
+    std::vector<uint8_t> out;
+    const auto queue_requests = [&](size_t count) {
+        out.clear();
+        for (size_t i = 0; i < count && sent < opts.requests; ++i, ++sent) {
+            request req;
+            req.id = static_cast<uint32_t>(sent);
+            req.index = rng() % opts.leaves;
+            const uint64_t dice = rng();
+            if (dice % 100 < opts.update_percent) {
+                req.op = opcode::UPDATE;
+                for (auto& byte : req.value) {
+                    byte = static_cast<uint8_t>(rng());
+                }
+            } else {
+                req.op = (dice >> 32) % 16 == 0 ? opcode::GET_ROOT : opcode::GET_HASH_PATH;
+            }
+            encode_request(req, out);
+        }
+        const auto now = clock_type::now();
+        for (size_t id = sent - count; id < sent; ++id) {
+            sent_at[id] = now;
+        }
+        send_all(fd, out);
+    };
+
+    queue_requests(std::min(opts.pipeline, opts.requests));
+    std::vector<uint8_t> in;
+    std::vector<response> responses;
+    uint8_t buf[64 * 1024];
+    while (received < opts.requests) {
+        const ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            throw std::runtime_error("Server closed the connection");
+        }
+        in.insert(in.end(), buf, buf + n);
+        responses.clear();
+        const size_t consumed = decode_responses(in.data(), in.size(), responses);
+        in.erase(in.begin(), in.begin() + static_cast<std::ptrdiff_t>(consumed));
+
+        const auto now = clock_type::now();
+        for (const auto& res : responses) {
+            if (res.id >= sent) {
+                close(fd);
+                throw std::runtime_error("Response for a request that was never sent");
+            }
+            result.latencies_us.push_back(std::chrono::duration<double, std::micro>(now - sent_at[res.id]).count());
+            result.errors += res.st != status::OK;
+        }
+        received += responses.size();
+        const size_t refill = std::min(responses.size(), opts.requests - sent);
+        if (refill > 0) {
+            queue_requests(refill);
+        }
+    }
+    close(fd);
+}
+
+options parse_options(int argc, char** argv)
+{
+    if (argc < 2) {
+        throw std::runtime_error("Usage: proof_loadgen <unix:path | tcp:port> [--connections C] [--pipeline W] "
+                                 "[--requests N] [--updates PCT] [--leaves L]");
+    }
+    options opts;
+    opts.ep = parse_endpoint(argv[1]);
+    for (int i = 2; i + 1 < argc; i += 2) {
+        const std::string flag = argv[i];
+        const uint64_t value = std::stoull(argv[i + 1]);
+        if (flag == "--connections") {
+            opts.connections = value;
+        } else if (flag == "--pipeline") {
+            opts.pipeline = value;
+        } else if (flag == "--requests") {
+            opts.requests = value;
+        } else if (flag == "--updates") {
+            opts.update_percent = static_cast<unsigned>(std::min<uint64_t>(value, 100));
+        } else if (flag == "--leaves") {
+            opts.leaves = value;
+        } else {
+            throw std::runtime_error("Unknown flag " + flag);
+        }
+    }
+    if (opts.connections == 0 || opts.pipeline == 0 || opts.leaves == 0 || opts.requests > UINT32_MAX) {
+        throw std::runtime_error("Bad options");
+    }
+    return opts;
+}
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    const size_t rank = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[rank];
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    try {
+        const options opts = parse_options(argc, argv);
+
+        std::vector<client_result> results(opts.connections);
+        std::vector<std::exception_ptr> failures(opts.connections);
+        std::vector<std::thread> threads;
+        const auto start = clock_type::now();
+        for (size_t c = 0; c < opts.connections; ++c) {
+            threads.emplace_back([&, c] {
+                try {
+                    run_client(opts, 0x5eed + c, results[c]);
+                } catch (...) {
+                    failures[c] = std::current_exception();
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        const double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+        for (const auto& failure : failures) {
+            if (failure) {
+                std::rethrow_exception(failure);
+            }
+        }
+
+        std::vector<double> latencies;
+        size_t errors = 0;
+        for (const auto& r : results) {
+            latencies.insert(latencies.end(), r.latencies_us.begin(), r.latencies_us.end());
+            errors += r.errors;
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "requests:   " << latencies.size() << " (" << errors << " errors)" << std::endl;
+        std::cout << "throughput: " << static_cast<double>(latencies.size()) / seconds << " req/s" << std::endl;
+        std::cout << "p50:        " << percentile(latencies, 0.50) << " us" << std::endl;
+        std::cout << "p99:        " << percentile(latencies, 0.99) << " us" << std::endl;
+        return errors == 0 ? 0 : 1;
+    } catch (const std::exception& ex) {
+        std::cerr << "proof_loadgen: " << ex.what() << std::endl;
+        return 1;
+    }
+}
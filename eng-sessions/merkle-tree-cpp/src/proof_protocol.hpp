@@ -0,0 +1,194 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Wire format of the proof service. Every message is a frame:
+ *
+ *   u32 body_length | body
+ *
+ * A request body is `u8 opcode | u32 id | payload`, a response body is `u8 status | u32 id | payload`. All integers
+ * are little-endian. `id` is chosen by the client and echoed back, so a client may pipeline as many requests as it
+ * likes on one connection. Responses on a connection come back in request order.
+ *
+ *   GET_ROOT       request payload: -                       response payload: root (32 bytes)
+ *   GET_HASH_PATH  request payload: u64 index               response payload: depth (lhs, rhs) pairs, leaf first
+ *   UPDATE         request payload: u64 index | value (64)  response payload: root (32 bytes)
+ *
+ * An ERROR response carries a human readable message as its payload.
+ */
+namespace proof_service {
+
+enum class opcode : uint8_t {
+    GET_ROOT = 1,
+    GET_HASH_PATH = 2,
+    UPDATE = 3,
+};
+
+enum class status : uint8_t {
+    OK = 0,
+    ERROR = 1,
+};
+
+constexpr size_t FRAME_HEADER_BYTES = 4;
+constexpr size_t VALUE_BYTES = 64;
+// Largest body either side will accept: a depth-32 hash path plus headers, with room to spare.
+constexpr size_t MAX_BODY_BYTES = 1 << 16;
+
+struct request {
+    uint32_t id = 0;
+    opcode op = opcode::GET_ROOT;
+    uint64_t index = 0;
+    std::array<uint8_t, VALUE_BYTES> value{};
+};
+
+struct response {
+    uint32_t id = 0;
+    status st = status::OK;
+    std::vector<uint8_t> payload;
+};
+
+inline void put_u32(std::vector<uint8_t>& out, uint32_t x)
+{
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back(static_cast<uint8_t>(x >> shift));
+    }
+}
+
+inline void put_u64(std::vector<uint8_t>& out, uint64_t x)
+{
+    for (int shift = 0; shift < 64; shift += 8) {
+        out.push_back(static_cast<uint8_t>(x >> shift));
+    }
+}
+
+inline uint32_t get_u32(const uint8_t* in)
+{
+    uint32_t x = 0;
+    for (int i = 3; i >= 0; --i) {
+        x = (x << 8) | in[i];
+    }
+    return x;
+}
+
+inline uint64_t get_u64(const uint8_t* in)
+{
+    uint64_t x = 0;
+    for (int i = 7; i >= 0; --i) {
+        x = (x << 8) | in[i];
+    }
+    return x;
+}
+
+/**
+ * Appends one framed request to `out`.
+ */
+inline void encode_request(const request& req, std::vector<uint8_t>& out)
+{
+    const size_t payload = req.op == opcode::GET_ROOT ? 0 : req.op == opcode::GET_HASH_PATH ? 8 : 8 + VALUE_BYTES;
+    put_u32(out, static_cast<uint32_t>(5 + payload));
+    out.push_back(static_cast<uint8_t>(req.op));
+    put_u32(out, req.id);
+    if (req.op != opcode::GET_ROOT) {
+        put_u64(out, req.index);
+    }
+    if (req.op == opcode::UPDATE) {
+        out.insert(out.end(), req.value.begin(), req.value.end());
+    }
+}
+
+/**
+ * Appends one framed response to `out`.
+ */
+inline void encode_response(const response& res, std::vector<uint8_t>& out)
+{
+    put_u32(out, static_cast<uint32_t>(5 + res.payload.size()));
+    out.push_back(static_cast<uint8_t>(res.st));
+    put_u32(out, res.id);
+    out.insert(out.end(), res.payload.begin(), res.payload.end());
+}
+
+/**
+ * Decodes every complete request frame at the start of [data, data + size) into `out`.
+ *
+ * @return The number of bytes consumed; a trailing partial frame is left for the next call.
+ *
+ * Throws std::runtime_error on a malformed frame, after which the stream cannot be resynchronised.
+ */
+inline size_t decode_requests(const uint8_t* data, size_t size, std::vector<request>& out)
+{
+    size_t pos = 0;
+    while (size - pos >= FRAME_HEADER_BYTES) {
+        const size_t body = get_u32(data + pos);
+        if (body < 5 || body > MAX_BODY_BYTES) {
+            throw std::runtime_error("Bad request frame length");
+        }
+        if (size - pos - FRAME_HEADER_BYTES < body) {
+            break;
+        }
+        const uint8_t* p = data + pos + FRAME_HEADER_BYTES;
+        request req;
+        req.op = static_cast<opcode>(p[0]);
+        req.id = get_u32(p + 1);
+        switch (req.op) {
+        case opcode::GET_ROOT:
+            if (body != 5) {
+                throw std::runtime_error("Bad GET_ROOT frame");
+            }
+            break;
+        case opcode::GET_HASH_PATH:
+            if (body != 5 + 8) {
+                throw std::runtime_error("Bad GET_HASH_PATH frame");
+            }
+            req.index = get_u64(p + 5);
+            break;
+        case opcode::UPDATE:
+            if (body != 5 + 8 + VALUE_BYTES) {
+                throw std::runtime_error("Bad UPDATE frame");
+            }
+            req.index = get_u64(p + 5);
+            std::memcpy(req.value.data(), p + 13, VALUE_BYTES);
+            break;
+        default:
+            throw std::runtime_error("Unknown opcode");
+        }
+        out.push_back(req);
+        pos += FRAME_HEADER_BYTES + body;
+    }
+    return pos;
+}
+
+/**
+ * Decodes every complete response frame at the start of [data, data + size) into `out`.
+ *
+ * @return The number of bytes consumed.
+ */
+inline size_t decode_responses(const uint8_t* data, size_t size, std::vector<response>& out)
+{
+    size_t pos = 0;
+    while (size - pos >= FRAME_HEADER_BYTES) {
+        const size_t body = get_u32(data + pos);
+        if (body < 5 || body > MAX_BODY_BYTES) {
+            throw std::runtime_error("Bad response frame length");
+        }
+        if (size - pos - FRAME_HEADER_BYTES < body) {
+            break;
+        }
+        const uint8_t* p = data + pos + FRAME_HEADER_BYTES;
+        response res;
+        res.st = static_cast<status>(p[0]);
+        res.id = get_u32(p + 1);
+        res.payload.assign(p + 5, p + body);
+        out.push_back(std::move(res));
+        pos += FRAME_HEADER_BYTES + body;
+    }
+    return pos;
+}
+
+} // namespace proof_service
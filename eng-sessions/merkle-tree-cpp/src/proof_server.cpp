@@ -0,0 +1,240 @@
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <exception>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "blake3_hasher.hpp"
+#include "merkle_tree.hpp"
+#include "mock_db.hpp"
+#include "proof_protocol.hpp"
+#include "proof_service.hpp"
+#include "proof_socket.hpp"
+#include "sha256_hasher.hpp"
+
+/**
+ * A single-threaded proof server around BasicMerkleTree.
+ *
+ *   proof_server <unix:path | tcp:port> [--depth N] [--hasher sha256|blake3]
+ *
+ * One poll() round reads everything every client has sent, hands all of the decoded requests to ProofService in one
+ * go (which coalesces each run of reads and each run of updates), and queues the responses back on their
+ * connections. The busier the server, the larger each batch. A client may half-close its connection after sending its
+ * requests: they are still served, and the connection is closed once their responses are sent. Stop it with SIGINT /
+ * SIGTERM.
+ */
+
+namespace {
+
+using namespace proof_service;
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void on_signal(int)
+{
+    stop_requested = 1;
+}
+
+void set_nonblocking(int fd)
+{
+    const int fl = fcntl(fd, F_GETFL, 0);
+    if (fl < 0 || fcntl(fd, F_SETFL, fl | O_NONBLOCK) < 0) {
+        throw socket_error("fcntl");
+    }
+}
+
+struct connection {
+    int fd;
+    std::vector<uint8_t> in;
+    std::vector<uint8_t> out;
+    size_t out_pos = 0;
+    bool eof = false;    // the client sends nothing more, but may still read
+    bool closed = false; // nothing more can be sent either
+};
+
+/**
+ * Reads whatever is available and decodes complete frames into `batch`, recording the owning connection of each.
+ * Requests decoded before the client hung up or failed are kept: their updates still apply, even if their responses
+ * cannot be sent.
+ */
+void read_requests(connection& conn, size_t conn_index, std::vector<request>& batch, std::vector<size_t>& owners)
+{
+    uint8_t buf[64 * 1024];
+    for (;;) {
+        const ssize_t n = recv(conn.fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            conn.in.insert(conn.in.end(), buf, buf + n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n == 0) {
+            conn.eof = true;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            conn.closed = true;
+        }
+        break;
+    }
+
+    try {
+        const size_t consumed = decode_requests(conn.in.data(), conn.in.size(), batch);
+        conn.in.erase(conn.in.begin(), conn.in.begin() + static_cast<std::ptrdiff_t>(consumed));
+    } catch (const std::exception& ex) {
+        std::cerr << "Dropping client: " << ex.what() << std::endl;
+        conn.closed = true;
+    }
+    owners.resize(batch.size(), conn_index);
+}
+
+void flush(connection& conn)
+{
+    while (conn.out_pos < conn.out.size()) {
+        const ssize_t n = send(conn.fd, conn.out.data() + conn.out_pos, conn.out.size() - conn.out_pos, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.out_pos += static_cast<size_t>(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                conn.closed = true;
+            }
+            return;
+        }
+    }
+    conn.out.clear();
+    conn.out_pos = 0;
+}
+
+template <Hasher HasherT> void serve(const endpoint& ep, uint32_t depth)
+{
+    MockDB db;
+    auto tree = BasicMerkleTree<HasherT>::create(db, "proof_server", depth);
+    ProofService<HasherT> service(tree);
+
+    const int listen_fd = listen_on(ep);
+    set_nonblocking(listen_fd);
+    std::cout << "Listening (depth " << depth << ")." << std::endl;
+
+    std::vector<connection> conns;
+    std::vector<pollfd> fds;
+    std::vector<request> batch;
+    std::vector<size_t> owners;
+    uint64_t batches = 0;
+    while (!stop_requested) {
+        fds.clear();
+        fds.push_back({ listen_fd, POLLIN, 0 });
+        for (const auto& conn : conns) {
+            const short events = static_cast<short>((conn.eof ? 0 : POLLIN) | (conn.out.empty() ? 0 : POLLOUT));
+            fds.push_back({ conn.fd, events, 0 });
+        }
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw socket_error("poll");
+        }
+
+        batch.clear();
+        owners.clear();
+        for (size_t i = 0; i < conns.size(); ++i) {
+            const short revents = fds[i + 1].revents;
+            if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                read_requests(conns[i], i, batch, owners);
+            }
+            if (revents & POLLOUT) {
+                flush(conns[i]);
+            }
+        }
+
+        if (!batch.empty()) {
+            const auto responses = service.handle(batch);
+            for (size_t i = 0; i < responses.size(); ++i) {
+                connection& conn = conns[owners[i]];
+                if (!conn.closed) {
+                    encode_response(responses[i], conn.out);
+                }
+            }
+            for (auto& conn : conns) {
+                flush(conn);
+            }
+            ++batches;
+        }
+
+        for (size_t i = conns.size(); i-- > 0;) {
+            // A half-closed connection stays open until the responses to its last requests are sent.
+            if (conns[i].closed || (conns[i].eof && conns[i].out.empty())) {
+                close(conns[i].fd);
+                conns.erase(conns.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            for (;;) {
+                const int fd = accept(listen_fd, nullptr, nullptr);
+                if (fd < 0) {
+                    break;
+                }
+                set_nonblocking(fd);
+                conns.push_back({ fd, {}, {}, 0, false, false });
+            }
+        }
+    }
+
+    for (auto& conn : conns) {
+        close(conn.fd);
+    }
+    close(listen_fd);
+    if (!ep.unix_path.empty()) {
+        unlink(ep.unix_path.c_str());
+    }
+
+    const auto& stats = service.get_stats();
+    std::cout << "Served " << stats.requests << " requests in " << batches << " batches (" << stats.read_batches
+              << " read sets, " << stats.update_batches << " update sets)." << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    try {
+        if (argc < 2) {
+            throw std::runtime_error("Usage: proof_server <unix:path | tcp:port> [--depth N] [--hasher sha256|blake3]");
+        }
+        const endpoint ep = parse_endpoint(argv[1]);
+        uint32_t depth = 32;
+        std::string hasher = "sha256";
+        for (int i = 2; i + 1 < argc; i += 2) {
+            const std::string flag = argv[i];
+            if (flag == "--depth") {
+                depth = static_cast<uint32_t>(std::stoul(argv[i + 1]));
+            } else if (flag == "--hasher") {
+                hasher = argv[i + 1];
+            } else {
+                throw std::runtime_error("Unknown flag " + flag);
+            }
+        }
+
+        std::signal(SIGINT, on_signal);
+        std::signal(SIGTERM, on_signal);
+        if (hasher == "sha256") {
+            serve<Sha256Hasher>(ep, depth);
+        } else if (hasher == "blake3") {
+            serve<Blake3Hasher>(ep, depth);
+        } else {
+            throw std::runtime_error("Unknown hasher " + hasher);
+        }
+        return 0;
+    } catch (const std::exception& ex) {
+        std::cerr << "proof_server: " << ex.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "merkle_tree.hpp"
+#include "proof_protocol.hpp"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace proof_service {
+
+/**
+ * Answers decoded requests against a tree, independent of any transport.
+ *
+ * `handle` is given every request that arrived together (across all connections, in arrival order) and coalesces
+ * them: each maximal run of reads (GET_ROOT / GET_HASH_PATH) is served by a single `get_hash_paths` call against the
+ * same tree state, and each maximal run of UPDATEs is applied with a single `update_elements` call, in arrival order
+ * (so the last write to a leaf wins). Runs are served in arrival order, so reads never overtake updates that arrived
+ * before them, nor updates reads: a client that pipelines an update and then a read of the same leaf sees its own
+ * write, and a read pipelined ahead of an update sees the tree from before it. Every UPDATE in a run is answered with
+ * the root after the whole run.
+ */
+template <Hasher HasherT> class ProofService {
+  public:
+    struct stats {
+        uint64_t requests = 0;
+        uint64_t read_batches = 0;
+        uint64_t update_batches = 0;
+    };
+
+    explicit ProofService(BasicMerkleTree<HasherT>& tree)
+        : tree(tree)
+    {}
+
+    /**
+     * @return One response per request, in the same order.
+     */
+    std::vector<response> handle(const std::vector<request>& batch)
+    {
+        std::vector<response> responses(batch.size());
+        for (size_t begin = 0; begin < batch.size();) {
+            const bool updates = batch[begin].op == opcode::UPDATE;
+            size_t end = begin + 1;
+            while (end < batch.size() && (batch[end].op == opcode::UPDATE) == updates) {
+                ++end;
+            }
+            if (updates) {
+                handle_updates(batch, begin, end, responses);
+            } else {
+                handle_reads(batch, begin, end, responses);
+            }
+            begin = end;
+        }
+        counters.requests += batch.size();
+        return responses;
+    }
+
+    const stats& get_stats() const
+    {
+        return counters;
+    }
+
+  private:
+    bool in_range(uint64_t index) const
+    {
+        return index < (uint64_t(1) << tree.get_depth());
+    }
+
+    static response error(uint32_t id, const std::string& message)
+    {
+        return { id, status::ERROR, std::vector<uint8_t>(message.begin(), message.end()) };
+    }
+
+    void handle_reads(const std::vector<request>& batch, size_t begin, size_t end, std::vector<response>& out)
+    {
+        std::vector<uint64_t> indices;
+        for (size_t i = begin; i < end; ++i) {
+            if (batch[i].op == opcode::GET_HASH_PATH && in_range(batch[i].index)) {
+                indices.push_back(batch[i].index);
+            }
+        }
+        const auto paths = tree.get_hash_paths(indices);
+        const auto root = tree.get_root();
+
+        size_t next_path = 0;
+        for (size_t i = begin; i < end; ++i) {
+            const request& req = batch[i];
+            if (req.op == opcode::GET_ROOT) {
+                out[i] = { req.id, status::OK, std::vector<uint8_t>(root.begin(), root.end()) };
+            } else if (!in_range(req.index)) {
+                out[i] = error(req.id, "Leaf index out of range");
+            } else {
+                response& res = out[i];
+                res.id = req.id;
+                for (const auto& [lhs, rhs] : paths[next_path++].data) {
+                    res.payload.insert(res.payload.end(), lhs.begin(), lhs.end());
+                    res.payload.insert(res.payload.end(), rhs.begin(), rhs.end());
+                }
+            }
+        }
+        ++counters.read_batches;
+    }
+
+    void handle_updates(const std::vector<request>& batch, size_t begin, size_t end, std::vector<response>& out)
+    {
+        std::vector<std::pair<uint64_t, std::vector<uint8_t>>> updates;
+        for (size_t i = begin; i < end; ++i) {
+            const request& req = batch[i];
+            if (in_range(req.index)) {
+                updates.emplace_back(req.index, std::vector<uint8_t>(req.value.begin(), req.value.end()));
+            }
+        }
+        const auto root = tree.update_elements(updates);
+
+        for (size_t i = begin; i < end; ++i) {
+            const request& req = batch[i];
+            out[i] = in_range(req.index)
+                         ? response{ req.id, status::OK, std::vector<uint8_t>(root.begin(), root.end()) }
+                         : error(req.id, "Leaf index out of range");
+        }
+        ++counters.update_batches;
+    }
+
+    BasicMerkleTree<HasherT>& tree;
+    stats counters;
+};
+
+} // namespace proof_service
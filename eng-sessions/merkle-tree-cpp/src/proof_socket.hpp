@@ -0,0 +1,109 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * Socket plumbing shared by the proof server and the load generator. The service only ever listens locally: either
+ * on a Unix domain socket or on a loopback TCP port.
+ */
+namespace proof_service {
+
+struct endpoint {
+    // Exactly one of the two is set.
+    std::string unix_path;
+    uint16_t tcp_port = 0;
+};
+
+inline std::runtime_error socket_error(const std::string& what)
+{
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+/**
+ * Parses `unix:<path>` or `tcp:<port>`.
+ */
+inline endpoint parse_endpoint(const std::string& spec)
+{
+    endpoint ep;
+    if (spec.rfind("unix:", 0) == 0 && spec.size() > 5) {
+        ep.unix_path = spec.substr(5);
+    } else if (spec.rfind("tcp:", 0) == 0) {
+        const unsigned long port = std::stoul(spec.substr(4));
+        if (port == 0 || port > 65535) {
+            throw std::runtime_error("Bad TCP port");
+        }
+        ep.tcp_port = static_cast<uint16_t>(port);
+    } else {
+        throw std::runtime_error("Endpoint must be unix:<path> or tcp:<port>");
+    }
+    return ep;
+}
+
+inline int open_socket(const endpoint& ep, bool listening)
+{
+    const int fd = socket(ep.unix_path.empty() ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw socket_error("socket");
+    }
+
+    int rc;
+    if (!ep.unix_path.empty()) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (ep.unix_path.size() >= sizeof(addr.sun_path)) {
+            close(fd);
+            throw std::runtime_error("Unix socket path too long");
+        }
+        std::memcpy(addr.sun_path, ep.unix_path.c_str(), ep.unix_path.size() + 1);
+        if (listening) {
+            unlink(ep.unix_path.c_str());
+            rc = bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        } else {
+            rc = connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        }
+    } else {
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(ep.tcp_port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (listening) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            rc = bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        } else {
+            rc = connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        }
+    }
+    if (rc < 0 || (listening && listen(fd, SOMAXCONN) < 0)) {
+        const auto err = socket_error(listening ? "bind/listen" : "connect");
+        close(fd);
+        throw err;
+    }
+    return fd;
+}
+
+/**
+ * Binds and listens on `ep`. A stale Unix socket file at the same path is replaced.
+ */
+inline int listen_on(const endpoint& ep)
+{
+    return open_socket(ep, true);
+}
+
+inline int connect_to(const endpoint& ep)
+{
+    return open_socket(ep, false);
+}
+
+} // namespace proof_service
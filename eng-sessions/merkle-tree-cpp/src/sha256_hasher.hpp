@@ -14,6 +14,8 @@ using sha256_hash_t = std::array<uint8_t, 32>;
  */
 class Sha256Hasher {
   public:
+    using hash_t = sha256_hash_t;
+
     /**
      * Given two 32-byte buffers, return a 32-byte digest representing their concatenation.
      */